@@ -1 +0,0 @@
-#include "dollar.hpp"
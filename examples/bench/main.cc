@@ -37,8 +37,18 @@ int main( int argc, char** argv )
     a.add<int>("nsrc_blocks", 's', "Number of source block after which we send code blocks", false, 1 );
     a.add<int>("ncode_blocks", 'c', "Number of coded blocks to send after processing nsrc_blocks", false, 1 );
 
+    a.add<int>("parity_columns", 'L', "Row/column parity instead of random code blocks: number of columns (0: off)", false, 0, cmdline::range(0, 32) );
+    a.add<int>("parity_rows", 'D', "Row/column parity: number of rows (columns x rows must not exceed 32)", false, 4, cmdline::range(1, 32) );
+
     a.add<float>("bad_state_proba", 'b', "Simulated loss - steady state probability for the bad state of Gilbert-Elliot model", false, 0.05f, cmdline::range(0.0, 1.0) );
     a.add<float>("expected_burst_length", 'B', "Simulated loss - expected sojourn time in the bad state (ie. error burst length)", false, 4.0f );
+    a.add<int>("lazy_payloads", 'l', "Decoder only XORs payloads of recovered packets (0: off, 1: on)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("inactivation", 'i', "Decoder solves undetermined rows by inactivation decoding (0: off, 1: on)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("selection", 'S', "Source packets of code blocks (0: uniform, 1: balanced coverage)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("include_newest", 'N', "Code blocks always include the newest source packet (0: off, 1: on)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("deferred_repair", 'r', "trevi_encode() only queues the source packet, code blocks are built when fetched (0: off, 1: on)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("num_packets", 'n', "Number of source packets to process", false, 10000000 );
+    a.add<int>("checksum", 'k', "Checksum of encoded packets (0: CRC-16, 1: CRC-32C)", false, 0, cmdline::range(0, 1) );
 
     a.parse_check(argc, argv);
 
@@ -46,9 +56,18 @@ int main( int argc, char** argv )
     int decodingWindowSize = a.get<int>( "decoding_window_size" );
     int nSrcBlocks = a.get<int>( "nsrc_blocks" );
     int nCodeBlocks = a.get<int>( "ncode_blocks" );
+    int parityColumns = a.get<int>( "parity_columns" );
+    int parityRows = a.get<int>( "parity_rows" );
 
     float badStateProba = a.get<float>( "bad_state_proba" );
     float burstLength = a.get<float>( "expected_burst_length" );
+    int lazyPayloads = a.get<int>( "lazy_payloads" );
+    int inactivation = a.get<int>( "inactivation" );
+    int selection = a.get<int>( "selection" );
+    int includeNewest = a.get<int>( "include_newest" );
+    int deferredRepair = a.get<int>( "deferred_repair" );
+    int numBenchmarkIter = a.get<int>( "num_packets" );
+    int checksum = a.get<int>( "checksum" );
 
     trevi_init();
 
@@ -65,9 +84,20 @@ int main( int argc, char** argv )
 
     trevi_encoder * encoder = trevi_create_encoder();
     trevi_encoder_add_stream( encoder, 0, encodingWindowSize, nSrcBlocks, nCodeBlocks );
+    trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_CHECKSUM, checksum );
+    trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_SELECTION, selection );
+    trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_INCLUDE_NEWEST, includeNewest );
+    trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_DEFERRED_REPAIR, deferredRepair );
+    if( trevi_encoder_set_stream_parity( encoder, 0, parityColumns, parityRows ) != 0 )
+    {
+        cerr << "Parity matrix too large: " << parityColumns << "x" << parityRows << endl;
+        return -1;
+    }
 
     trevi_decoder * decoder = trevi_create_decoder();
     trevi_decoder_add_stream( decoder, 0, decodingWindowSize );
+    trevi_decoder_set_stream_option( decoder, 0, TREVI_DECODER_LAZY_PAYLOADS, lazyPayloads );
+    trevi_decoder_set_stream_option( decoder, 0, TREVI_DECODER_INACTIVATION, inactivation );
 
     double t_encode_sum = 0.0;
     double t_decode_sum = 0.0;
@@ -76,7 +106,6 @@ int main( int argc, char** argv )
     int decodeOpsCpt = 0;
 
     int dataBlockSize = 1024;
-    int numBenchmarkIter = 10000000;
     int lossesCpt = 0;              // Total simulated losses
     int encodedPacketsCpt = 0;      // Total encoded packets generated
 
@@ -175,10 +204,25 @@ int main( int argc, char** argv )
             cerr << "Packets unrecovered: " << packetLossCpt << " / " << i << " - Packet loss probability: " << packetLossProbabilty * 100.0 << "%" << endl;
             double avgDelay = delaySum / (double)packetRecovCpt;
             cerr << "(Average delay - decoding_window_size) (in slots): " << avgDelay << endl;
+            trevi_decoder_drop_counters dropCounters;
+            trevi_decoder_get_drop_counters( decoder, &dropCounters );
+            cerr << "Packets dropped by integrity checks: " << dropCounters.bad_checksum << " bad checksum, " << dropCounters.malformed << " malformed" << endl;
+            cerr << "Packets dropped as redundant: " << dropCounters.redundant << endl;
+            trevi_decoder_stats decoderStats;
+            trevi_decoder_get_stats( decoder, &decoderStats );
+            cerr << "Decode latency (ns): p50=" << decoderStats.decode_latency.p50_ns << " p99=" << decoderStats.decode_latency.p99_ns
+                 << " p99.9=" << decoderStats.decode_latency.p999_ns << " max=" << decoderStats.decode_latency.max_ns << endl;
+            cerr << "Reordering delay (ns): p50=" << decoderStats.reordering_delay.p50_ns << " p99=" << decoderStats.reordering_delay.p99_ns << endl;
+            for( int s = 0; s < decoderStats.num_streams; ++s )
+            {
+                const trevi_stream_stats& ss = decoderStats.streams[s];
+                cerr << "Stream " << ss.stream_id << ": recovered=" << ss.recovered << " unrecoverable=" << ss.unrecoverable << " resyncs=" << ss.resyncs
+                     << " solver_rank=" << ss.solver_rank << " window_occupancy=" << ss.window_occupancy << " backlog=" << ss.backlog << " expired=" << ss.expired << endl;
+            }
             cerr << "-----------------------------------------------------------------------" << endl;
-        }
 
-        dump_profiling_info();
+            dump_profiling_info();
+        }
 
     }
 
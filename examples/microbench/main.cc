@@ -0,0 +1,506 @@
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <trevi.h>
+#include "gf256.h"
+#include "codeblock.h"
+#include "composition.h"
+#include "ogesolver.h"
+#include "reorderingbuffer.h"
+#include "sessiontable.h"
+#include "streamencoder.h"
+
+#include "microbench.h"
+#include "cmdline.h"
+
+using namespace std;
+
+// Every heap allocation of the process goes through here, so that benchmarks
+// can report how many allocations their loop performs.
+unsigned long long g_allocCount = 0;
+
+void* operator new( std::size_t size )
+{
+    g_allocCount++;
+    void* p = malloc( size ? size : 1 );
+    if( p == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+// Keeps results alive so that the compiler does not optimize benchmarks away
+static volatile uint32_t g_sink = 0;
+
+static void fillRandom( uint8_t* buffer, int size, std::mt19937& rng )
+{
+    for( int k = 0; k < size; ++k )
+    {
+        buffer[k] = (uint8_t)rng();
+    }
+}
+
+static void benchAddMem( BenchState& st, int size )
+{
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > a( size ), b( size );
+    fillRandom( a.data(), size, rng );
+    fillRandom( b.data(), size, rng );
+    while( st.keepRunning() )
+    {
+        gf256_add_mem( a.data(), b.data(), size );
+    }
+    g_sink = a[0];
+    st.setBytesProcessed( st.iterations() * size );
+}
+
+static void benchMulAddMem( BenchState& st, int size )
+{
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > a( size ), b( size );
+    fillRandom( a.data(), size, rng );
+    fillRandom( b.data(), size, rng );
+    uint8_t y = 2;
+    while( st.keepRunning() )
+    {
+        gf256_muladd_mem( a.data(), y, b.data(), size );
+        y = y == 255 ? 2 : y + 1;
+    }
+    g_sink = a[0];
+    st.setBytesProcessed( st.iterations() * size );
+}
+
+// One source XORed into count outputs, in a single pass over the source
+static void benchAddNMem( BenchState& st, int size, int count )
+{
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > a( size * count ), b( size );
+    fillRandom( a.data(), size * count, rng );
+    fillRandom( b.data(), size, rng );
+    void* outputs[ 8 ];
+    for( int k = 0; k < count; ++k )
+    {
+        outputs[k] = a.data() + k * size;
+    }
+    while( st.keepRunning() )
+    {
+        gf256_addn_mem( outputs, count, b.data(), size );
+    }
+    g_sink = a[0];
+    st.setBytesProcessed( st.iterations() * size * count );
+}
+
+static void benchCodeBlockFromPayload( BenchState& st, int size )
+{
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > payload( size );
+    fillRandom( payload.data(), size, rng );
+    while( st.keepRunning() )
+    {
+        std::shared_ptr< CodeBlock > cb = std::make_shared< CodeBlock >( size, payload.data(), size );
+        g_sink = cb->payload_size();
+    }
+    st.setBytesProcessed( st.iterations() * size );
+}
+
+static void benchCodeBlockFromRaw( BenchState& st, int size )
+{
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > payload( size );
+    fillRandom( payload.data(), size, rng );
+    CodeBlock model( size, payload.data(), size );
+    while( st.keepRunning() )
+    {
+        std::shared_ptr< CodeBlock > cb = std::make_shared< CodeBlock >( model.buffer_ptr(), model.buffer_size() );
+        g_sink = cb->payload_size();
+    }
+    st.setBytesProcessed( st.iterations() * size );
+}
+
+static std::vector< std::shared_ptr< CodeBlock > > compositionPool()
+{
+    std::mt19937 rng( 42 );
+    std::vector< std::shared_ptr< CodeBlock > > pool;
+    uint8_t payload[ 64 ] = { 0 };
+    for( int k = 0; k < 256; ++k )
+    {
+        std::shared_ptr< CodeBlock > cb = std::make_shared< CodeBlock >( sizeof(payload), payload, sizeof(payload) );
+        cb->setComposition( Composition( 1000 + k, (uint32_t)rng() | 1 ) );
+        pool.push_back( cb );
+    }
+    return pool;
+}
+
+// Composition decoding as it was done before the Composition type
+static void benchCompositionStdSet( BenchState& st )
+{
+    std::vector< std::shared_ptr< CodeBlock > > pool = compositionPool();
+    size_t i = 0;
+    while( st.keepRunning() )
+    {
+        CodeBlock& cb = *pool[ i++ % pool.size() ];
+        std::set< uint32_t > compo;
+        uint32_t mask = cb.composition().mask();
+        uint32_t offset = cb.get_stream_sequence_idx();
+        for( int b = 0; b < 32; ++b )
+        {
+            if( (mask >> b) & 1 )
+            {
+                compo.insert( b + offset );
+            }
+        }
+        uint32_t acc = *compo.begin() + *compo.rbegin();
+        for( uint32_t idx : compo )
+        {
+            acc += idx;
+        }
+        g_sink = acc;
+    }
+}
+
+static void benchCompositionMask( BenchState& st )
+{
+    std::vector< std::shared_ptr< CodeBlock > > pool = compositionPool();
+    size_t i = 0;
+    while( st.keepRunning() )
+    {
+        Composition compo = pool[ i++ % pool.size() ]->composition();
+        uint32_t acc = compo.front() + compo.back();
+        for( uint32_t idx : compo )
+        {
+            acc += idx;
+        }
+        g_sink = acc;
+    }
+}
+
+static void benchCompositionXor( BenchState& st )
+{
+    std::vector< std::shared_ptr< CodeBlock > > pool = compositionPool();
+    size_t i = 0;
+    while( st.keepRunning() )
+    {
+        Composition a = pool[ i % pool.size() ]->composition();
+        Composition b = pool[ (i + 1) % pool.size() ]->composition();
+        i++;
+        a.normalize();
+        b.normalize();
+        a.xorWith( Composition( a.offset(), b.mask() ) );
+        g_sink = a.empty() ? 0 : a.front();
+    }
+}
+
+// Encoded blocks of a stream of random source blocks, after Bernoulli losses
+static std::vector< std::shared_ptr< CodeBlock > > encodedStream( int count, int blockSize, int encodingWindowSize, double loss )
+{
+    std::mt19937 rng( 42 );
+    std::bernoulli_distribution lost( loss );
+    std::vector< uint8_t > buffer( blockSize );
+    StreamEncoder encoder( encodingWindowSize, 1, 1 );
+    std::vector< std::shared_ptr< CodeBlock > > ret;
+    for( int i = 0; i < count; ++i )
+    {
+        fillRandom( buffer.data(), blockSize, rng );
+        encoder.addData( buffer.data(), blockSize );
+        while( encoder.hasEncodedBlocks() )
+        {
+            std::shared_ptr< CodeBlock > cb = encoder.getEncodedBlock();
+            if( !lost( rng ) )
+            {
+                ret.push_back( cb );
+            }
+        }
+    }
+    return ret;
+}
+
+static void benchSolverAddBlock( BenchState& st, int blockSize, int encodingWindowSize, double loss, bool lazy, int budget )
+{
+    const int decodingWindowSize = 2 * encodingWindowSize;
+    std::vector< std::shared_ptr< CodeBlock > > blocks = encodedStream( 2048, blockSize, encodingWindowSize, loss );
+
+    std::unique_ptr< OGESolver > oge;
+    uint32_t maxSeqIdx = 0;
+    size_t i = 0;
+    while( st.keepRunning() )
+    {
+        if( i % blocks.size() == 0 )
+        {
+            st.pauseTiming();
+            oge.reset( new OGESolver( decodingWindowSize ) );
+            oge->setLazyPayloads( lazy );
+            oge->setWorkBudget( budget );
+            maxSeqIdx = 0;
+            st.resumeTiming();
+        }
+        std::shared_ptr< CodeBlock >& cb = blocks[ i++ % blocks.size() ];
+
+        // Window management, as done by StreamDecoder
+        uint32_t back = cb->composition().back() + 1;
+        maxSeqIdx = max( maxSeqIdx, back );
+        int targetMin = max( 0, (int)maxSeqIdx - decodingWindowSize + 1 );
+        if( targetMin > (int)oge->offset() )
+        {
+            oge->shiftWindowTo( targetMin );
+        }
+
+        oge->addBlock( cb );
+        oge->_output.clear();
+    }
+    st.setItemsProcessed( st.iterations() );
+}
+
+static void benchReorderingBuffer( BenchState& st, int windowSize )
+{
+    uint8_t payload[ 256 ] = { 0 };
+    std::shared_ptr< SourceBlock > sb = std::make_shared< SourceBlock >( payload, (int)sizeof(payload) );
+    ReorderingBuffer buffer( windowSize );
+    uint32_t i = 0;
+    while( st.keepRunning() )
+    {
+        // Recovered blocks come out slightly out of order: swap pairs
+        uint32_t idx = (i & 1) ? i - 1 : i + 1;
+        DecodeOutput deco;
+        deco.block = sb;
+        deco.stream_idx = idx;
+        deco.global_idx = idx;
+        deco.decode_time_ns = 0;
+        buffer.addBlock( deco );
+        while( buffer.available() )
+        {
+            g_sink = buffer.pop()->payload_size();
+        }
+        i++;
+    }
+    st.setItemsProcessed( st.iterations() );
+}
+
+// Source blocks encoded with numCodeBlockPerSourceBlock repair blocks each
+static void benchStreamEncoder( BenchState& st, int numCodeBlockPerSourceBlock )
+{
+    const int blockSize = 1500;
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > source( blockSize );
+    fillRandom( source.data(), blockSize, rng );
+
+    StreamEncoder encoder( 32, 1, numCodeBlockPerSourceBlock );
+    while( st.keepRunning() )
+    {
+        encoder.addData( source.data(), blockSize );
+        while( encoder.hasEncodedBlocks() )
+        {
+            g_sink = encoder.getEncodedBlock()->payload_size();
+        }
+    }
+    st.setBytesProcessed( st.iterations() * blockSize );
+}
+
+static void benchEndToEnd( BenchState& st, int encodingWindowSize, double loss, bool arena )
+{
+    const int blockSize = 1024;
+    std::mt19937 rng( 42 );
+    std::bernoulli_distribution lost( loss );
+    std::vector< uint8_t > source( blockSize );
+    std::vector< uint8_t > buffer( 2 * blockSize );
+    fillRandom( source.data(), blockSize, rng );
+
+    trevi_encoder * encoder = trevi_create_encoder();
+    trevi_encoder_add_stream( encoder, 0, encodingWindowSize );
+    trevi_decoder * decoder = trevi_create_decoder();
+    trevi_decoder_add_stream( decoder, 0, 2 * encodingWindowSize );
+    if( arena )
+    {
+        trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_BLOCK_ARENA, blockSize );
+        trevi_decoder_set_stream_option( decoder, 0, TREVI_DECODER_BLOCK_ARENA, blockSize );
+    }
+
+    while( st.keepRunning() )
+    {
+        trevi_encode( encoder, 0, source.data(), blockSize );
+        int esize;
+        while( (esize = trevi_encoder_get_encoded_data( encoder, buffer.data() )) > 0 )
+        {
+            if( !lost( rng ) )
+            {
+                trevi_decode( decoder, buffer.data(), esize );
+            }
+        }
+        unsigned int pktIdx;
+        while( trevi_decoder_get_decoded_data( decoder, buffer.data(), &pktIdx ) > 0 )
+        {
+            g_sink = pktIdx;
+        }
+    }
+    st.setBytesProcessed( st.iterations() * blockSize );
+}
+
+// Lookup cost of the session table: every session has received one block, and
+// receives it again, so that the block is dropped as a duplicate right after
+// its session is found
+static void benchSessionDemux( BenchState& st, int sessionCount )
+{
+    const int blockSize = 256;
+    std::mt19937 rng( 42 );
+    std::vector< uint8_t > source( blockSize );
+    fillRandom( source.data(), blockSize, rng );
+
+    Encoder encoder;
+    StreamEncoder streamEncoder( 8, 1, 1 );
+    encoder.addStream( 0, &streamEncoder );
+    encoder.addData( 0, source.data(), blockSize );
+    std::shared_ptr< CodeBlock > cb = encoder.getEncodedBlock();
+
+    SessionTable table( 16, UINT64_MAX );
+    std::vector< uint32_t > addresses( sessionCount );
+    for( int k = 0; k < sessionCount; ++k )
+    {
+        addresses[k] = (uint32_t)rng();
+        table.addCodeBlock( &addresses[k], 4, 0, cb->buffer_ptr(), cb->buffer_size(), 0 );
+    }
+
+    int k = 0;
+    while( st.keepRunning() )
+    {
+        table.addCodeBlock( &addresses[k], 4, 0, cb->buffer_ptr(), cb->buffer_size(), 0 );
+        k = k + 1 < sessionCount ? k + 1 : 0;
+    }
+    g_sink = table.sessionCount();
+    st.setItemsProcessed( st.iterations() );
+}
+
+int main( int argc, char** argv )
+{
+    cmdline::parser a;
+
+    a.add<string>("filter", 'f', "Only run benchmarks whose name contains this string", false, "" );
+    a.add<double>("min_time", 't', "Minimum run time of each benchmark, in seconds", false, 0.2 );
+    a.add<string>("json", 'j', "Write results as JSON to this file ('-' for standard output)", false, "" );
+    a.add<string>("simd", 's', "Force a SIMD code path (portable, ssse3, avx2, avx2-gfni, avx512, avx512-gfni)", false, "" );
+
+    a.parse_check(argc, argv);
+
+    trevi_init();
+
+    string simd = a.get<string>( "simd" );
+    if( !simd.empty() )
+    {
+        int path = 0;
+        while( path < GF256_SIMD_PATH_COUNT && simd != gf256_simd_path_name( (gf256_simd_path)path ) )
+        {
+            path++;
+        }
+        if( gf256_set_simd_path( (gf256_simd_path)path ) != 0 )
+        {
+            cerr << "SIMD code path " << simd << " is not available on this host" << endl;
+            return 1;
+        }
+    }
+    cerr << "SIMD code path: " << trevi_get_simd_path() << endl;
+
+    BenchRunner runner;
+    runner.setMinTime( a.get<double>( "min_time" ) );
+    runner.addContext( "simd_path", trevi_get_simd_path() );
+
+    const int sizes[] = { 64, 256, 1500, 9000, 65536 };
+    for( int size : sizes )
+    {
+        runner.add( "gf256_add_mem/" + to_string( size ), [size]( BenchState& st ) { benchAddMem( st, size ); }, true );
+        runner.add( "gf256_muladd_mem/" + to_string( size ), [size]( BenchState& st ) { benchMulAddMem( st, size ); }, true );
+    }
+
+    const int addnCounts[] = { 1, 4, 8 };
+    for( int count : addnCounts )
+    {
+        runner.add( "gf256_addn_mem/1500/count:" + to_string( count ), [count]( BenchState& st ) { benchAddNMem( st, 1500, count ); }, true );
+    }
+
+    const int blockSizes[] = { 64, 1500, 9000 };
+    for( int size : blockSizes )
+    {
+        runner.add( "codeblock_from_payload/" + to_string( size ), [size]( BenchState& st ) { benchCodeBlockFromPayload( st, size ); } );
+        runner.add( "codeblock_from_raw/" + to_string( size ), [size]( BenchState& st ) { benchCodeBlockFromRaw( st, size ); } );
+    }
+
+    runner.add( "composition_std_set", benchCompositionStdSet );
+    runner.add( "composition_mask", benchCompositionMask, true );
+    runner.add( "composition_xor", benchCompositionXor, true );
+
+    const int losses[] = { 0, 5, 20 };
+    for( int loss : losses )
+    {
+        for( int lazy = 0; lazy <= 1; ++lazy )
+        {
+            runner.add( "oge_add_block/loss:" + to_string( loss ) + "/lazy:" + to_string( lazy ),
+                        [loss, lazy]( BenchState& st ) { benchSolverAddBlock( st, 1024, 16, loss / 100.0, lazy != 0, 0 ); } );
+        }
+    }
+    // Jumbo frames and a 64 block decoding window, where recovery bursts outgrow the L1 cache
+    for( int lazy = 0; lazy <= 1; ++lazy )
+    {
+        runner.add( "oge_add_block/size:9000/ew:32/loss:20/lazy:" + to_string( lazy ),
+                    [lazy]( BenchState& st ) { benchSolverAddBlock( st, 9000, 32, 0.2, lazy != 0, 0 ); } );
+    }
+    // Same, with the work per block capped: the deferred work is spread over the next blocks
+    runner.add( "oge_add_block/size:9000/ew:32/loss:20/budget:16",
+                []( BenchState& st ) { benchSolverAddBlock( st, 9000, 32, 0.2, false, 16 ); } );
+
+    const int reorderingWindows[] = { 16, 64 };
+    for( int w : reorderingWindows )
+    {
+        runner.add( "reordering_buffer/window:" + to_string( w ), [w]( BenchState& st ) { benchReorderingBuffer( st, w ); } );
+    }
+
+    const int repairCounts[] = { 1, 2, 4 };
+    for( int ncode : repairCounts )
+    {
+        runner.add( "stream_encoder/ew:32/ncode:" + to_string( ncode ), [ncode]( BenchState& st ) { benchStreamEncoder( st, ncode ); } );
+    }
+
+    const int encodingWindows[] = { 8, 16, 32 };
+    for( int ew : encodingWindows )
+    {
+        runner.add( "end_to_end/ew:" + to_string( ew ) + "/loss:5", [ew]( BenchState& st ) { benchEndToEnd( st, ew, 0.05, false ); } );
+    }
+    runner.add( "end_to_end/ew:32/loss:5/arena", []( BenchState& st ) { benchEndToEnd( st, 32, 0.05, true ); } );
+
+    const int sessionCounts[] = { 100, 10000 };
+    for( int n : sessionCounts )
+    {
+        runner.add( "session_demux/sessions:" + to_string( n ), [n]( BenchState& st ) { benchSessionDemux( st, n ); }, true );
+    }
+
+    int failures = runner.run( a.get<string>( "filter" ) );
+
+    string jsonPath = a.get<string>( "json" );
+    if( jsonPath == "-" )
+    {
+        cout << runner.json( argv[0] );
+    }
+    else if( !jsonPath.empty() )
+    {
+        ofstream ofs( jsonPath );
+        ofs << runner.json( argv[0] );
+    }
+
+    if( failures > 0 )
+    {
+        cerr << failures << " benchmark(s) expected to be allocation-free did allocate" << endl;
+        return 1;
+    }
+
+    return 0;
+}
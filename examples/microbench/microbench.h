@@ -0,0 +1,304 @@
+#pragma once
+
+// Minimal benchmark harness, in the spirit of Google Benchmark: each benchmark
+// is a function looping on BenchState::keepRunning(), the runner grows the
+// iteration count until a minimum run time is reached, and results can be
+// written as JSON using Google Benchmark's field names so that existing
+// comparison tools can consume them.
+
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+// Number of heap allocations since the start of the process (see main.cc)
+extern unsigned long long g_allocCount;
+
+class BenchState
+{
+public:
+    BenchState( int64_t iterations )
+        :_iterations(iterations), _done(0), _running(false), _realNs(0.0), _cpuNs(0.0), _allocs(0),
+          _bytesProcessed(0), _itemsProcessed(0)
+    {
+    }
+
+    // Loop condition, timing starts on the first call
+    bool keepRunning()
+    {
+        if( _done == 0 && !_running )
+        {
+            resumeTiming();
+        }
+        if( _done < _iterations )
+        {
+            _done++;
+            return true;
+        }
+        pauseTiming();
+        return false;
+    }
+
+    // Exclude setup work done inside the loop from the measurements
+    void pauseTiming()
+    {
+        if( !_running )
+        {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        _realNs += std::chrono::duration<double, std::nano>( now - _realStart ).count();
+        _cpuNs += (double)(std::clock() - _cpuStart) * 1e9 / CLOCKS_PER_SEC;
+        _allocs += g_allocCount - _allocStart;
+        _running = false;
+    }
+
+    void resumeTiming()
+    {
+        _allocStart = g_allocCount;
+        _cpuStart = std::clock();
+        _realStart = std::chrono::steady_clock::now();
+        _running = true;
+    }
+
+    int64_t iterations() const { return _iterations; }
+    double realNs() const { return _realNs; }
+    double cpuNs() const { return _cpuNs; }
+    unsigned long long allocs() const { return _allocs; }
+
+    void setBytesProcessed( int64_t bytes ) { _bytesProcessed = bytes; }
+    int64_t bytesProcessed() const { return _bytesProcessed; }
+
+    void setItemsProcessed( int64_t items ) { _itemsProcessed = items; }
+    int64_t itemsProcessed() const { return _itemsProcessed; }
+
+private:
+    int64_t _iterations;
+    int64_t _done;
+    bool _running;
+
+    std::chrono::steady_clock::time_point _realStart;
+    std::clock_t _cpuStart;
+    unsigned long long _allocStart;
+
+    double _realNs;
+    double _cpuNs;
+    unsigned long long _allocs;
+
+    int64_t _bytesProcessed;
+    int64_t _itemsProcessed;
+};
+
+struct Benchmark
+{
+    std::string name;
+    std::function< void( BenchState& ) > fn;
+    bool expectNoAlloc;
+};
+
+struct BenchResult
+{
+    std::string name;
+    int64_t iterations;
+    double realNsPerIter;
+    double cpuNsPerIter;
+    double allocsPerIter;
+    double bytesPerSecond;
+    double itemsPerSecond;
+    bool allocFailure;
+};
+
+class BenchRunner
+{
+public:
+    BenchRunner()
+        :_minTimeSec(0.2)
+    {
+    }
+
+    void add( const std::string& name, std::function< void( BenchState& ) > fn, bool expectNoAlloc = false )
+    {
+        Benchmark b;
+        b.name = name;
+        b.fn = fn;
+        b.expectNoAlloc = expectNoAlloc;
+        _benchmarks.push_back( b );
+    }
+
+    void setMinTime( double seconds )
+    {
+        _minTimeSec = seconds;
+    }
+
+    // Extra key written in the "context" object of the JSON output
+    void addContext( const std::string& key, const std::string& value )
+    {
+        _context.push_back( std::make_pair( key, value ) );
+    }
+
+    // Runs every benchmark whose name contains filter, returns the number of
+    // allocation-free benchmarks that allocated.
+    int run( const std::string& filter )
+    {
+        int failures = 0;
+        printHeader();
+        for( const Benchmark& b : _benchmarks )
+        {
+            if( !filter.empty() && b.name.find( filter ) == std::string::npos )
+            {
+                continue;
+            }
+            BenchResult r = runOne( b );
+            printResult( r );
+            if( r.allocFailure )
+            {
+                failures++;
+            }
+            _results.push_back( r );
+        }
+        return failures;
+    }
+
+    std::string json( const std::string& executable )
+    {
+        std::stringstream sstr;
+        char date[ 64 ];
+        std::time_t now = std::time( nullptr );
+        std::strftime( date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime( &now ) );
+
+        sstr << "{\n";
+        sstr << "  \"context\": {\n";
+        sstr << "    \"date\": \"" << date << "\",\n";
+        sstr << "    \"executable\": \"" << escape( executable ) << "\",\n";
+        for( const std::pair< std::string, std::string >& c : _context )
+        {
+            sstr << "    \"" << escape( c.first ) << "\": \"" << escape( c.second ) << "\",\n";
+        }
+#ifdef NDEBUG
+        sstr << "    \"library_build_type\": \"release\"\n";
+#else
+        sstr << "    \"library_build_type\": \"debug\"\n";
+#endif
+        sstr << "  },\n";
+        sstr << "  \"benchmarks\": [";
+        for( size_t i = 0; i < _results.size(); ++i )
+        {
+            const BenchResult& r = _results[i];
+            sstr << (i == 0 ? "\n" : ",\n");
+            sstr << "    {\n";
+            sstr << "      \"name\": \"" << escape( r.name ) << "\",\n";
+            sstr << "      \"run_name\": \"" << escape( r.name ) << "\",\n";
+            sstr << "      \"run_type\": \"iteration\",\n";
+            sstr << "      \"iterations\": " << r.iterations << ",\n";
+            sstr << std::setprecision( 10 );
+            sstr << "      \"real_time\": " << r.realNsPerIter << ",\n";
+            sstr << "      \"cpu_time\": " << r.cpuNsPerIter << ",\n";
+            sstr << "      \"time_unit\": \"ns\",\n";
+            if( r.bytesPerSecond > 0.0 )
+            {
+                sstr << "      \"bytes_per_second\": " << r.bytesPerSecond << ",\n";
+            }
+            if( r.itemsPerSecond > 0.0 )
+            {
+                sstr << "      \"items_per_second\": " << r.itemsPerSecond << ",\n";
+            }
+            sstr << "      \"allocs_per_iter\": " << r.allocsPerIter << "\n";
+            sstr << "    }";
+        }
+        sstr << "\n  ]\n}\n";
+        return sstr.str();
+    }
+
+private:
+    BenchResult runOne( const Benchmark& b )
+    {
+        int64_t iterations = 1;
+        BenchState* last = nullptr;
+        while( true )
+        {
+            delete last;
+            last = new BenchState( iterations );
+            b.fn( *last );
+            double sec = last->realNs() * 1e-9;
+            if( sec >= _minTimeSec || iterations >= 1000000000 )
+            {
+                break;
+            }
+            // Same growth rule as Google Benchmark
+            double multiplier = sec <= 0.0 ? 10.0 : _minTimeSec * 1.4 / sec;
+            if( multiplier > 10.0 )
+            {
+                multiplier = 10.0;
+            }
+            int64_t next = (int64_t)(iterations * multiplier);
+            iterations = next > iterations ? next : iterations + 1;
+        }
+
+        BenchResult r;
+        r.name = b.name;
+        r.iterations = last->iterations();
+        r.realNsPerIter = last->realNs() / r.iterations;
+        r.cpuNsPerIter = last->cpuNs() / r.iterations;
+        r.allocsPerIter = (double)last->allocs() / r.iterations;
+        double sec = last->realNs() * 1e-9;
+        r.bytesPerSecond = sec > 0.0 ? last->bytesProcessed() / sec : 0.0;
+        r.itemsPerSecond = sec > 0.0 ? last->itemsProcessed() / sec : 0.0;
+        r.allocFailure = b.expectNoAlloc && last->allocs() != 0;
+        delete last;
+        return r;
+    }
+
+    void printHeader()
+    {
+        std::cout << std::left << std::setw( 40 ) << "Benchmark" << std::right
+                  << std::setw( 14 ) << "Time (ns)" << std::setw( 14 ) << "CPU (ns)"
+                  << std::setw( 12 ) << "Iterations" << std::setw( 12 ) << "Allocs/it"
+                  << "  Throughput" << std::endl;
+        std::cout << std::string( 118, '-' ) << std::endl;
+    }
+
+    void printResult( const BenchResult& r )
+    {
+        std::cout << std::left << std::setw( 40 ) << r.name << std::right << std::fixed << std::setprecision( 1 )
+                  << std::setw( 14 ) << r.realNsPerIter << std::setw( 14 ) << r.cpuNsPerIter
+                  << std::setw( 12 ) << r.iterations << std::setw( 12 ) << std::setprecision( 2 ) << r.allocsPerIter;
+        if( r.bytesPerSecond > 0.0 )
+        {
+            std::cout << "  " << std::setprecision( 1 ) << r.bytesPerSecond / (1024.0 * 1024.0) << " MiB/s";
+        }
+        if( r.itemsPerSecond > 0.0 )
+        {
+            std::cout << "  " << std::setprecision( 1 ) << r.itemsPerSecond / 1000.0 << " k items/s";
+        }
+        if( r.allocFailure )
+        {
+            std::cout << "  ALLOCATES";
+        }
+        std::cout << std::endl;
+    }
+
+    static std::string escape( const std::string& s )
+    {
+        std::string ret;
+        for( char c : s )
+        {
+            if( c == '"' || c == '\\' )
+            {
+                ret += '\\';
+            }
+            ret += c;
+        }
+        return ret;
+    }
+
+    double _minTimeSec;
+    std::vector< Benchmark > _benchmarks;
+    std::vector< BenchResult > _results;
+    std::vector< std::pair< std::string, std::string > > _context;
+};
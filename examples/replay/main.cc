@@ -0,0 +1,162 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+
+#include <cstdint>
+
+#include <trevi.h>
+#include "tracefile.h"
+#include "stats.h"
+
+#include "cmdline.h"
+
+using namespace std;
+
+// One line per power of two of nanoseconds
+static void printHistogram( ostream& os, const LatencyHistogram& histogram )
+{
+    const int subBuckets = LatencyHistogram::SUB_BUCKETS;
+    vector< uint64_t > counts = histogram.bucketCounts();
+    vector< uint64_t > perOctave( counts.size() / subBuckets, 0 );
+    uint64_t peak = 0;
+    for( size_t b = 0; b < counts.size(); ++b )
+    {
+        perOctave[ b / subBuckets ] += counts[b];
+        peak = max( peak, perOctave[ b / subBuckets ] );
+    }
+    for( size_t o = 0; o < perOctave.size(); ++o )
+    {
+        if( perOctave[o] == 0 )
+        {
+            continue;
+        }
+        uint64_t lo = o == 0 ? 0 : LatencyHistogram::bucketUpperBound( (int)(o * subBuckets - 1) ) + 1;
+        uint64_t hi = LatencyHistogram::bucketUpperBound( (int)(o * subBuckets + subBuckets - 1) );
+        int bar = (int)(50 * perOctave[o] / peak);
+        os << setw( 12 ) << lo << " - " << setw( 12 ) << hi << " ns " << setw( 10 ) << perOctave[o] << " "
+           << string( bar > 0 ? bar : 1, '#' ) << endl;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    cmdline::parser a;
+
+    a.add<int>("window_size", 'd', "Override the decoding window size recorded in the trace (0: keep)", false, 0 );
+    a.add<int>("lazy_payloads", 'l', "Decoder only XORs payloads of recovered packets (0: off, 1: on)", false, 0, cmdline::range(0, 1) );
+    a.add<int>("repeat", 'n', "Number of times the trace is replayed, each time through a new decoder", false, 1 );
+    a.footer( "trace_file" );
+
+    a.parse_check(argc, argv);
+
+    if( a.rest().size() != 1 )
+    {
+        cerr << a.usage();
+        return 1;
+    }
+
+    string tracePath = a.rest()[0];
+    int windowOverride = a.get<int>( "window_size" );
+    int lazyPayloads = a.get<int>( "lazy_payloads" );
+    int repeat = a.get<int>( "repeat" );
+
+    // Load the whole trace first, so that replay is not slowed down by file reads
+    TraceReader reader;
+    if( !reader.open( tracePath ) )
+    {
+        cerr << "Could not open trace file " << tracePath << endl;
+        return 1;
+    }
+    vector< TraceRecord > records;
+    TraceRecord record;
+    uint64_t packetCount = 0;
+    uint64_t byteCount = 0;
+    while( reader.next( record ) )
+    {
+        if( record.type == TRACE_RECORD_PACKET )
+        {
+            packetCount++;
+            byteCount += record.data.size();
+        }
+        records.push_back( record );
+    }
+
+    double durationSec = records.empty() ? 0.0 : records.back().timestampUs * 1e-6;
+    cerr << "Trace: " << packetCount << " packets, " << byteCount << " bytes, recorded over " << durationSec << " s" << endl;
+
+    trevi_init();
+
+    LatencyHistogram decodeLatency;
+    uint64_t decodedCount = 0;
+    uint64_t unrecoveredCount = 0;
+    trevi_decoder_drop_counters dropCounters = { 0, 0, 0 };
+    vector< uint8_t > buffer( 65536 );
+
+    auto replayStart = std::chrono::steady_clock::now();
+    for( int r = 0; r < repeat; ++r )
+    {
+        trevi_decoder * decoder = trevi_create_decoder();
+        int64_t lastPktIdx = -1;
+
+        for( const TraceRecord& rec : records )
+        {
+            if( rec.type == TRACE_RECORD_STREAM_ADDED )
+            {
+                int window = windowOverride > 0 ? windowOverride : (int)rec.decodingWindowSize;
+                trevi_decoder_add_stream( decoder, rec.streamId, window );
+                trevi_decoder_set_stream_option( decoder, rec.streamId, TREVI_DECODER_LAZY_PAYLOADS, lazyPayloads );
+                continue;
+            }
+            if( rec.type == TRACE_RECORD_STREAM_REMOVED )
+            {
+                trevi_decoder_remove_stream( decoder, rec.streamId );
+                continue;
+            }
+
+            uint64_t start = stats_now_ns();
+            trevi_decode( decoder, rec.data.data(), (int)rec.data.size() );
+            decodeLatency.record( stats_now_ns() - start );
+
+            unsigned int pktIdx;
+            while( trevi_decoder_get_decoded_data( decoder, buffer.data(), &pktIdx ) > 0 )
+            {
+                decodedCount++;
+                if( (int64_t)pktIdx > lastPktIdx + 1 )
+                {
+                    unrecoveredCount += pktIdx - lastPktIdx - 1;
+                }
+                if( (int64_t)pktIdx > lastPktIdx )
+                {
+                    lastPktIdx = pktIdx;
+                }
+            }
+        }
+
+        trevi_decoder_drop_counters dc;
+        trevi_decoder_get_drop_counters( decoder, &dc );
+        dropCounters.bad_checksum += dc.bad_checksum;
+        dropCounters.malformed += dc.malformed;
+        dropCounters.redundant += dc.redundant;
+    }
+    double replaySec = std::chrono::duration<double>( std::chrono::steady_clock::now() - replayStart ).count();
+
+    LatencySummary summary = decodeLatency.summary();
+    cout << "Replayed " << summary.count << " packets in " << replaySec << " s ("
+         << (replaySec > 0.0 ? summary.count / replaySec : 0.0) << " packets/s)" << endl;
+    cout << "Decoded packets: " << decodedCount << ", unrecovered: " << unrecoveredCount << endl;
+    cout << "Dropped by integrity checks: " << dropCounters.bad_checksum << " bad checksum, " << dropCounters.malformed << " malformed" << endl;
+    cout << "Dropped as redundant: " << dropCounters.redundant << endl;
+    cout << endl;
+    cout << "Per-packet decode latency (ns):" << endl;
+    cout << "  mean  " << fixed << setprecision( 0 ) << summary.meanNs << endl;
+    cout << "  p50   " << summary.p50Ns << endl;
+    cout << "  p90   " << summary.p90Ns << endl;
+    cout << "  p99   " << summary.p99Ns << endl;
+    cout << "  p99.9 " << summary.p999Ns << endl;
+    cout << "  max   " << summary.maxNs << endl;
+    cout << endl;
+    printHistogram( cout, decodeLatency );
+
+    return 0;
+}
@@ -21,6 +21,7 @@ int main( int argc, char** argv )
     a.add<int>("output_port", 'o', "UDP port for decoded output data", false, 5000 );
     a.add<string>("output_host", 'h', "address of destination host for decoded data", false, "127.0.0.1" );
     a.add<int>("window_size", 'd', "Decoding window size (must be strictly superior to encoding window size)", false, 64 );
+    a.add<string>("record", 'r', "Record received packets to this trace file, to be replayed with trevi_replay", false, "" );
 
     a.parse_check(argc, argv);
 
@@ -44,13 +45,19 @@ int main( int argc, char** argv )
     UDPTransmitter udpt( udpOutputPort, udpOutputHost );
 
     int dsize = 0;
-    unsigned int pktIdx;
 
     uint8_t buffer[ 2048 ];
 
     trevi_decoder * decoder = trevi_create_decoder();
     trevi_decoder_add_stream( decoder, 0, a.get<int>("window_size") );
 
+    string tracePath = a.get<string>("record");
+    if( !tracePath.empty() && trevi_decoder_start_recording( decoder, tracePath.c_str() ) != 0 )
+    {
+        cerr << "Could not open trace file " << tracePath << endl;
+        return 1;
+    }
+
     double t_sum = 0.0;
     int iterCpt = 0;
 
@@ -73,15 +80,17 @@ int main( int argc, char** argv )
 
             while( true )
             {
-                dsize = trevi_decoder_get_decoded_data( decoder, buffer, &pktIdx );
+                trevi_decoded_view view;
+                dsize = trevi_decoder_get_decoded_view( decoder, &view );
                 if( dsize < 0 )
                 {
                     break;
                 }
                 else
                 {
-                    // cerr << "dsize=" << dsize << " pktIdx=" << pktIdx << endl;
-                    udpt.send( buffer, dsize );
+                    // cerr << "dsize=" << dsize << " pktIdx=" << view.seq_idx << endl;
+                    udpt.send( (uint8_t*)view.data, dsize );
+                    trevi_decoder_release_view( decoder, &view );
                 }
             }
         }
@@ -92,9 +101,9 @@ int main( int argc, char** argv )
         {
             double t_decode = t_sum / (double)iterCpt;
             cerr << "Average decode processing time = " << t_decode << " microsec." << endl;
-        }
 
-        dump_profiling_info();
+            dump_profiling_info();
+        }
 
     }
 
@@ -26,6 +26,7 @@ int main( int argc, char** argv )
     a.add<int>("nsrc_blocks", 's', "Number of source block after which we send code blocks", false, 1 );
     a.add<int>("ncode_blocks", 'c', "Number of coded blocks to send after processing nsrc_blocks", false, 1 );
     a.add<float>("loss_proba", 'p', "Simulated random uniform packet loss probability", false, 0.0f, cmdline::range(0.0, 1.0) );
+    a.add<int>("checksum", 'k', "Checksum of encoded packets (0: CRC-16, 1: CRC-32C)", false, 0, cmdline::range(0, 1) );
 
     a.parse_check(argc, argv);
 
@@ -58,6 +59,7 @@ int main( int argc, char** argv )
 
     // Add a new stream to the encoder, here stream of id 0, with an encoding window size of 32
     trevi_encoder_add_stream( encoder, 0, encodingWindowSize, nSrcBlocks, nCodeBlocks );
+    trevi_encoder_set_stream_option( encoder, 0, TREVI_ENCODER_CHECKSUM, a.get<int>("checksum") );
 
     UDPReceiver udpr( udpInputPort );
     UDPTransmitter udpt( udpOutputPort, udpOutputHost  );
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <cstddef>
+#include <cstdint>
+
+// Room for block headers and footers, on top of the payload
+static const int BLOCK_ARENA_SLOT_OVERHEAD = 64;
+static const size_t BLOCK_ARENA_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// One contiguous region holding the block buffers of a stream window, in
+// fixed-size slots indexed by window position: the buffer of a block is found
+// by address arithmetic, and a whole window spans a few TLB entries.
+//
+// The region is backed by 2 MB huge pages when the system has some reserved
+// (MAP_HUGETLB), else by transparent huge pages when enabled (madvise), else
+// by regular pages. Blocks keep their slot busy, and the arena alive, for as
+// long as they are referenced: acquire() returns nullptr instead of reusing a
+// busy slot, and callers then fall back to the heap.
+class BlockArena : public std::enable_shared_from_this< BlockArena >
+{
+public:
+    // Slots fit blocks of up to maxPayloadSize payload bytes
+    static std::shared_ptr< BlockArena > create( int maxPayloadSize, int slotCount );
+    virtual ~BlockArena();
+
+    // Memory of slot index % slotCount(), nullptr if the slot is busy or too small
+    std::shared_ptr< void > acquire( uint32_t index, int bufferSize );
+
+    int slotSize() const;
+    int slotCount() const;
+    bool hugePages() const;
+
+private:
+    BlockArena( int maxPayloadSize, int slotCount );
+    void release( int slot );
+
+    uint8_t* _base;
+    size_t _regionSize;
+    bool _mapped;
+    bool _hugePages;
+    int _slotSize;
+    int _slotCount;
+    std::unique_ptr< std::atomic< bool >[] > _busy;
+
+    BlockArena( const BlockArena& ) = delete;
+    BlockArena& operator=( const BlockArena& ) = delete;
+};
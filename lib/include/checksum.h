@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// Checksums protecting the blocks on the wire
+static const uint8_t CHECKSUM_CRC16 = 0;    // CRC-16/XMODEM
+static const uint8_t CHECKSUM_CRC32C = 1;   // CRC-32C (Castagnoli)
+static const uint8_t CHECKSUM_UNKNOWN = 0xFF;
+
+// CRCs are linear when computed from a zero register, without initial value
+// nor final XOR. These "raw" CRCs let us derive the checksum of a block built
+// by XORing or concatenating other blocks from their known checksums, instead
+// of reading the whole block again.
+
+// Raw CRC of a buffer
+uint32_t checksum_raw( uint8_t type, const void* buffer, int size );
+
+// Raw CRC of (A || B), knowing the raw CRCs of A and B
+uint32_t checksum_concat( uint8_t type, uint32_t rawA, uint32_t rawB, int sizeB );
+
+// Raw CRC of a buffer padded with zeros at the end, knowing the raw CRC of the buffer
+uint32_t checksum_pad( uint8_t type, uint32_t raw, int padSize );
+
+// Checksum value, as written on the wire, from the raw CRC of a buffer of the given size
+uint32_t checksum_final( uint8_t type, uint32_t raw, int size );
+
+// Checksum value of a buffer, as written on the wire
+uint32_t checksum_compute( uint8_t type, const void* buffer, int size );
@@ -1,21 +1,77 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include <memory>
-#include <set>
+#include <vector>
 
 #include "datablock.h"
+#include "checksum.h"
+#include "composition.h"
 #include "utils.h"
 
+// CodeBlock header, as laid out on the wire (byte orders in wire.h)
+#pragma pack(push, 1)
+struct CodeBlockWireHeader
+{
+    uint8_t mns[2];
+    uint8_t seqIdx[4];
+    uint8_t composition[4];
+    uint8_t payloadSize[2];
+    uint8_t reserved0[2];
+    uint8_t streamId;
+    uint8_t flags;
+    uint8_t epoch[4];
+};
+#pragma pack(pop)
+
+static_assert( sizeof(CodeBlockWireHeader) == 20, "CodeBlock header must be 20 bytes" );
+
+// Host view of a CodeBlock header, filled from a single bounded copy of the raw buffer
+struct CodeBlockHeader
+{
+    uint16_t mns;
+    uint32_t seqIdx;
+    uint32_t composition;
+    uint16_t payloadSize;
+    uint8_t streamId;
+    uint8_t flags;
+    uint32_t epoch;
+
+    // Returns false if the buffer is too small to hold a header
+    bool read( const void* buffer, int bufferSize )
+    {
+        CodeBlockWireHeader wh;
+        if( buffer == nullptr || bufferSize < (int)sizeof(wh) )
+            return false;
+        memcpy( &wh, buffer, sizeof(wh) );
+        mns = read16FromBuffer( wh.mns );
+        seqIdx = read32FromBuffer( wh.seqIdx );
+        composition = read32FromBuffer( wh.composition );
+        payloadSize = read16FromBuffer( wh.payloadSize );
+        streamId = wh.streamId;
+        flags = wh.flags;
+        epoch = read32FromBuffer( wh.epoch );
+        return true;
+    }
+};
+
 class CodeBlock : public DataBlock
 {
 public:
     // Constructor from payload
     CodeBlock( uint16_t mtu, const void * payloadBuffer, int payloadSize );
 
-    // Constructor from raw buffer
-    CodeBlock( const void * rawBuffer, int rawBufferSize );
+    // Constructor from raw buffer, optionally stored in a slot of a block arena
+    CodeBlock( const void * rawBuffer, int rawBufferSize, BlockArena* arena = nullptr, uint32_t slot = 0 );
+
+    // Constructor for a zero payload, to be computed in place
+    explicit CodeBlock( int payloadSize, BlockArena* arena = nullptr, uint32_t slot = 0 );
+
+    // Constructor from the XOR of the payloads of several blocks
+    CodeBlock( const std::vector< std::shared_ptr< CodeBlock > >& blocks );
 
     virtual ~CodeBlock();
 
@@ -28,18 +84,43 @@ public:
     void set_stream_id(uint8_t value);
     uint8_t get_stream_id();
 
+    // Random value drawn by the encoder when its stream starts: a new epoch
+    // tells the decoder that the encoder restarted. Never 0.
+    void set_epoch(uint32_t value);
+    uint32_t get_epoch();
+
+    // Whole header in one read, false if the buffer cannot hold one
+    bool readHeader( CodeBlockHeader& header );
+
+    // Checksum protecting the whole block, stored in the header flags.
+    // CRC-16 leaves room for the end marker in the footer, CRC-32C uses all of it.
+    void setChecksumType( uint8_t type );
+    uint8_t checksumType();
+
     void updateCRC();
-    uint16_t readCRC();
+    // Same as updateCRC(), knowing the raw CRC of the payload area (see checksum.h): only the header is read
+    void updateCRC( uint32_t rawPayloadCRC );
+    uint32_t readCRC();
+    uint32_t computeCRC();
     bool isCorrectCRC();
 
-    void setCompositionField(uint32_t offset, std::set< uint32_t > compoSet );
+    // Checks that the header is consistent with the buffer size, before trusting any field
+    bool isWellFormed();
+
+    // Identifies a raw block from its header and checksum, without reading its
+    // payload: identical blocks have the same fingerprint. 0 if the buffer is too small.
+    static uint64_t fingerprint( const void* rawBuffer, int rawBufferSize );
+
+    // Sequence indices of the source blocks XORed in this block. The offset is
+    // stored as the stream sequence index, the mask as the composition field.
+    void setComposition( const Composition& compo );
+    Composition composition();
     void dumpCompositionField();
     std::string dumpCompositionFieldStr();
-    std::set<uint32_t> getCompositionSet();
 
     int degree();
 
-    std::shared_ptr< CodeBlock > clone();
+    std::shared_ptr< CodeBlock > clone( BlockArena* arena = nullptr, uint32_t slot = 0 );
 
     void XOR_payload( std::shared_ptr< CodeBlock > other );
 
@@ -55,11 +136,14 @@ private:
     void setMNS();
     void setMNE();
 
-    static const int CODEBLOCK_HEADER_SIZE = 20;
-    static const int CODEBLOCK_STREAM_SEQ_IDX_OFFSET = 2;
-    static const int CODEBLOCK_COMPO_OFFSET = 6;
-    static const int CODEBLOCK_PAYLOAD_SIZE_OFFSET = 10;
-    static const int CODEBLOCK_STREAM_ID_OFFSET = 14;
+    static const int CODEBLOCK_HEADER_SIZE = sizeof(CodeBlockWireHeader);
+    static const int CODEBLOCK_STREAM_SEQ_IDX_OFFSET = offsetof(CodeBlockWireHeader, seqIdx);
+    static const int CODEBLOCK_COMPO_OFFSET = offsetof(CodeBlockWireHeader, composition);
+    static const int CODEBLOCK_PAYLOAD_SIZE_OFFSET = offsetof(CodeBlockWireHeader, payloadSize);
+    static const int CODEBLOCK_STREAM_ID_OFFSET = offsetof(CodeBlockWireHeader, streamId);
+    static const int CODEBLOCK_FLAGS_OFFSET = offsetof(CodeBlockWireHeader, flags);
+    static const int CODEBLOCK_EPOCH_OFFSET = offsetof(CodeBlockWireHeader, epoch);
+    static const uint8_t CODEBLOCK_FLAGS_CHECKSUM_MASK = 0x03;
     static const int CODEBLOCK_FOOTER_SIZE = 4;
     static const uint16_t CODEBLOCK_MNS = 0x2609;
     static const uint16_t CODEBLOCK_MNE = 0x2804;
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Bit helpers, v must not be 0 for ctz/clz
+inline int composition_ctz( uint32_t v )
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward( &idx, v );
+    return (int)idx;
+#else
+    return __builtin_ctz( v );
+#endif
+}
+
+inline int composition_clz( uint32_t v )
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse( &idx, v );
+    return 31 - (int)idx;
+#else
+    return __builtin_clz( v );
+#endif
+}
+
+inline int composition_popcount( uint32_t v )
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt( v );
+#else
+    return __builtin_popcount( v );
+#endif
+}
+
+// Serial number arithmetic (RFC 1982) on stream sequence indices, which wrap
+// around at 2^32: a is before b if b is less than 2^31 indices ahead of a
+inline bool seq_before( uint32_t a, uint32_t b )
+{
+    return (int32_t)(a - b) < 0;
+}
+
+inline uint32_t seq_max( uint32_t a, uint32_t b )
+{
+    return seq_before( a, b ) ? b : a;
+}
+
+// Set of stream sequence indices covered by a CodeBlock, stored as on the wire:
+// a base offset and a 32-bit mask, bit i meaning that offset + i is in the set.
+// Iteration visits indices in increasing order with count-trailing-zeros and
+// nothing here ever allocates.
+class Composition
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef uint32_t value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const uint32_t* pointer;
+        typedef uint32_t reference;
+
+        const_iterator( uint32_t offset, uint32_t mask )
+            :_offset(offset), _mask(mask)
+        {
+        }
+
+        uint32_t operator*() const
+        {
+            return _offset + composition_ctz( _mask );
+        }
+
+        const_iterator& operator++()
+        {
+            _mask &= _mask - 1;
+            return *this;
+        }
+
+        bool operator==( const const_iterator& other ) const
+        {
+            return _mask == other._mask;
+        }
+
+        bool operator!=( const const_iterator& other ) const
+        {
+            return _mask != other._mask;
+        }
+
+    private:
+        uint32_t _offset;
+        uint32_t _mask;
+    };
+
+    static const int MAX_SPAN = 32;
+
+    Composition()
+        :_offset(0), _mask(0)
+    {
+    }
+
+    Composition( uint32_t offset, uint32_t mask )
+        :_offset(offset), _mask(mask)
+    {
+    }
+
+    uint32_t offset() const
+    {
+        return _offset;
+    }
+
+    uint32_t mask() const
+    {
+        return _mask;
+    }
+
+    bool empty() const
+    {
+        return _mask == 0;
+    }
+
+    int size() const
+    {
+        return composition_popcount( _mask );
+    }
+
+    // Smallest and largest index, the set must not be empty
+    uint32_t front() const
+    {
+        return _offset + composition_ctz( _mask );
+    }
+
+    uint32_t back() const
+    {
+        return _offset + 31 - composition_clz( _mask );
+    }
+
+    bool contains( uint32_t idx ) const
+    {
+        uint32_t bit = idx - _offset;
+        return bit < MAX_SPAN && ((_mask >> bit) & 1);
+    }
+
+    // idx must lie in [offset, offset + 32)
+    void insert( uint32_t idx )
+    {
+        _mask |= (uint32_t)1 << (idx - _offset);
+    }
+
+    void erase( uint32_t idx )
+    {
+        uint32_t bit = idx - _offset;
+        if( bit < MAX_SPAN )
+        {
+            _mask &= ~((uint32_t)1 << bit);
+        }
+    }
+
+    void clear()
+    {
+        _mask = 0;
+    }
+
+    // Move the offset to the smallest index, so that bit 0 is set
+    void normalize()
+    {
+        if( _mask == 0 )
+        {
+            return;
+        }
+        int shift = composition_ctz( _mask );
+        _offset += shift;
+        _mask >>= shift;
+    }
+
+    // Symmetric difference with another set. Both sets together must fit in
+    // a 32-wide window once the common leading indices cancel out, which is
+    // always the case for two equations sharing the same smallest index.
+    void xorWith( const Composition& other )
+    {
+        if( other._mask == 0 )
+        {
+            return;
+        }
+        if( _mask == 0 )
+        {
+            *this = other;
+            return;
+        }
+        uint32_t base = seq_before( other._offset, _offset ) ? other._offset : _offset;
+        uint64_t m = ((uint64_t)_mask << (_offset - base)) ^ ((uint64_t)other._mask << (other._offset - base));
+        if( m == 0 )
+        {
+            _offset = base;
+            _mask = 0;
+            return;
+        }
+        int shift = (uint32_t)m != 0 ? composition_ctz( (uint32_t)m ) : 32 + composition_ctz( (uint32_t)(m >> 32) );
+        _offset = base + shift;
+        _mask = (uint32_t)(m >> shift);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator( _offset, _mask );
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator( _offset, 0 );
+    }
+
+    bool operator==( const Composition& other ) const
+    {
+        if( _mask == 0 || other._mask == 0 )
+        {
+            return _mask == other._mask;
+        }
+        return front() == other.front() && (_mask >> composition_ctz( _mask )) == (other._mask >> composition_ctz( other._mask ));
+    }
+
+    bool operator!=( const Composition& other ) const
+    {
+        return !(*this == other);
+    }
+
+    std::string str() const
+    {
+        std::stringstream sstr;
+        for( uint32_t idx : *this )
+        {
+            sstr << idx << " ";
+        }
+        return sstr.str();
+    }
+
+private:
+    uint32_t _offset;
+    uint32_t _mask;
+};
@@ -6,8 +6,20 @@
 extern "C" {
 #endif /* __cplusplus  */
 
+/* Builds the slice-by-8 tables (done on first use otherwise) */
+void crc16_init(void);
+
 uint16_t crc16(const char *buf, int len);
 
+/* Continues a CRC computation over buf, starting from a previous crc value */
+uint16_t crc16_update(uint16_t crc, const char *buf, int len);
+
+/* CRC of a message followed by len zero bytes, knowing the CRC of the message.
+ * The CRC is linear: crc16(a ^ b) == crc16(a) ^ crc16(b) for messages of the
+ * same length, so CRCs of XORed or concatenated blocks can be derived from the
+ * CRCs of their parts without reading them again. */
+uint16_t crc16_shift(uint16_t crc, int len);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus  */
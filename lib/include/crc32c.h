@@ -0,0 +1,37 @@
+#ifndef _CRC_CRC32C_H
+#define _CRC_CRC32C_H
+
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus  */
+
+/* CRC-32C (Castagnoli), as used by iSCSI/SCTP/ext4.
+ *
+ * Poly                       : 1EDC6F41 (reflected: 82F63B78)
+ * Initialization             : FFFFFFFF
+ * Reflect Input/Output       : True
+ * Xor constant to output CRC : FFFFFFFF
+ * Output for "123456789"     : E3069283
+ *
+ * crc32c_init() selects the fastest implementation for the running CPU:
+ * SSE4.2 crc32 instruction over 3 interleaved streams merged with PCLMULQDQ,
+ * or a portable slice-by-8 table implementation. It is called by trevi_init(),
+ * and on first use otherwise. */
+void crc32c_init(void);
+
+/* Continues a CRC-32C computation (use crc = 0 to start a new one) */
+uint32_t crc32c(uint32_t crc, const void *buf, int len);
+
+/* Raw CRC register (no initial value nor final XOR) of a message followed by
+ * len zero bytes, knowing the raw register of the message. Raw registers are
+ * linear, see crc16_shift(). */
+uint32_t crc32c_shift(uint32_t crc, int len);
+
+/* Returns 1 if the hardware accelerated implementation is in use */
+int crc32c_hw_enabled(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus  */
+#endif
@@ -2,6 +2,9 @@
 
 #include <memory>
 
+#include <cstdint>
+
+class BlockArena;
 class DataBlock
 {
 public:
@@ -14,10 +17,16 @@ public:
     virtual uint16_t payload_size(){ return 0; }
     virtual void * payload_ptr(){ return nullptr; }
 
+    // Reference to the payload sharing ownership of the underlying buffer
+    std::shared_ptr<void> payload_ref();
+
 private:
 
 protected:
     void initMemory( int bufferSize );
+    // Buffer from the given arena slot when possible, from the heap otherwise
+    void initMemory( int bufferSize, BlockArena* arena, uint32_t slot );
+    void shareMemory( std::shared_ptr<void> bufferRef, int bufferSize );
     int                     _bufferSize;
     std::shared_ptr<void>   _data;
 
@@ -4,6 +4,7 @@
 
 #include <cstdint>
 
+#include "composition.h"
 #include "sourceblock.h"
 
 typedef struct
@@ -11,12 +12,14 @@ typedef struct
     std::shared_ptr< SourceBlock > block;
     uint32_t stream_idx;
     uint32_t global_idx;
+    uint64_t decode_time_ns;    // stats_now_ns() when the block was decoded
+    bool recovered;             // Rebuilt from repair blocks, not received as is
 } DecodeOutput;
 
 struct DecodeOutputComparator
 {
     inline bool operator() (const DecodeOutput& struct1, const DecodeOutput& struct2)
     {
-        return (struct1.global_idx < struct2.global_idx);
+        return seq_before( struct1.global_idx, struct2.global_idx );
     }
 };
@@ -1,32 +1,119 @@
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <vector>
 
 #include "streamdecoder.h"
 #include "decodeoutput.h"
 #include "reorderingbuffer.h"
+#include "tracefile.h"
+#include "stats.h"
 
 class Decoder
 {
 public:
-    Decoder();
+    // duplicateFilterSize: number of recent blocks remembered to drop duplicates, a power of two
+    // recordLatency: false leaves decodeLatency() and reorderingDelay() empty,
+    // sparing their per-thread shards
+    Decoder( int duplicateFilterSize = DUPLICATE_FILTER_SIZE, bool recordLatency = true );
     virtual ~Decoder();
 
     void addStream(int streamId, StreamDecoder* decoder);
     void removeStream( int streamId );
 
-    void addCodeBlock( const void* buffer, int bufferSize );
-    void addCodeBlock( std::shared_ptr<CodeBlock> cb );
+    // QUEUE_ACCEPTED, QUEUE_DROPPED or QUEUE_REJECTED, see setOutputLimits()
+    // and StreamDecoder::setQueueLimits()
+    int addCodeBlock( const void* buffer, int bufferSize );
+    int addCodeBlock( std::shared_ptr<CodeBlock> cb );
 
     void onNewDecodeOutput( const DecodeOutput& deco );
+    // An encoder restarted: its indices start over
+    void onStreamResync();
+
+    // Releases the blocks held for reordering, whatever their indices
+    void flush();
+
+    // Decoded blocks are held for reordering until 64 more are decoded, which
+    // may never happen at the end of a burst. With a hold timeout (0: none),
+    // blocks following the last released one without gap are released at
+    // once, and the others once held for holdNs: the missing blocks before
+    // them are given up on.
+    void setHoldTimeout( uint64_t holdNs );
+    // Applies the hold timeout, also done by addCodeBlock(). Returns the number
+    // of blocks released.
+    int poll( uint64_t nowNs );
 
     bool available();
     std::shared_ptr< SourceBlock > pop();
 
+    // Resumes the solver work deferred by the stream work budgets, up to budget
+    // row operations over all streams (0: all of it)
+    void run( int budget );
+    // Deferred solver work items, over all streams
+    int backlog();
+
+    // Bounds the decoded blocks held for reordering or waiting for pop(). Over
+    // the limits, the oldest ones are dropped, or incoming blocks are refused
+    // until the application catches up (DROP_REJECT).
+    void setOutputLimits( const QueueLimits& limits );
+    // Decoded blocks dropped to stay within the output limits
+    uint64_t droppedOutputCount();
+
+    // Bytes held by the streams and by the decoded blocks not popped yet
+    size_t memoryUse();
+    // Bytes of the decoded blocks not popped yet, readable from any thread
+    const StatsGauge& outputBytes();
+
+    // Incoming blocks rejected before reaching the stream decoders
+    uint64_t droppedBadChecksumCount();
+    uint64_t droppedMalformedCount();
+    uint64_t droppedRedundantCount();
+
+    // Back to the state of a new decoder, forgetting the decoded blocks not
+    // popped yet. Streams and options are kept.
+    void reset();
+
+    // Record every incoming packet, as received, to a trace file for offline replay
+    bool startRecording( const std::string& path );
+    void stopRecording();
+
+    // Time spent in addCodeBlock()
+    const LatencyHistogram& decodeLatency();
+    // Time between the decoding of a packet and its retrieval with pop()
+    const LatencyHistogram& reorderingDelay();
+
 private:
+    int ingest( std::shared_ptr<CodeBlock> cb );
+    bool isAccepting();
+    int enforceOutputLimits();
+    bool isRedundant( const void* buffer, int bufferSize );
+
+    // Fingerprints of recently accepted blocks, direct mapped: a newer block
+    // evicts an older one with the same slot
+    static const int DUPLICATE_FILTER_SIZE = 1024;
+    std::vector< uint64_t > _recentFingerprints;
+
     std::shared_ptr< ReorderingBuffer > _buffer;
     std::map< uint8_t, StreamDecoder * > _decoders;
 
+    // Written by the decoding thread only, readable from any thread. Relaxed
+    // atomics rather than StatsCounter shards, which would cost 2 KB per decoder.
+    std::atomic< uint64_t > _droppedBadChecksum;
+    std::atomic< uint64_t > _droppedMalformed;
+    std::atomic< uint64_t > _droppedRedundant;
+    std::atomic< uint64_t > _droppedOutputs;
+    StatsGauge _outputBytes;        // Of the decoded blocks held, for readers of other threads
+
+    QueueLimits _outputLimits;
+    uint64_t _holdTimeoutNs;
+
+    std::shared_ptr< TraceWriter > _recorder;
+
+    LatencyHistogram _decodeLatency;
+    LatencyHistogram _reorderingDelay;
+    bool _recordLatency;
+
 protected:
 
 };
@@ -5,6 +5,7 @@
 #include <cstdint>
 
 #include "streamencoder.h"
+#include "stats.h"
 
 class Encoder
 {
@@ -15,15 +16,46 @@ public:
     void addStream( int stremaId, StreamEncoder* encoder );
     void removeStream( int streamId );
 
-    void addData( int streamId, std::shared_ptr<SourceBlock> sb );
-    void addData( int streamId, const void* buffer, int bufferSize );
+    // QUEUE_ACCEPTED, QUEUE_DROPPED, QUEUE_REJECTED, or -1 if there is no such stream
+    int addData( int streamId, std::shared_ptr<SourceBlock> sb );
+    int addData( int streamId, const void* buffer, int bufferSize );
 
     bool hasEncodedBlocks();
+    // Blocks already built come first, from any stream: deferred repair blocks
+    // are only built once none is left
     std::shared_ptr< CodeBlock > getEncodedBlock();
 
+    // Builds the deferred repair blocks of all streams, see
+    // StreamEncoder::setDeferredRepair(). Returns how many were built, less
+    // the blocks then dropped by the queue limits.
+    int flushRepairs();
+
+    // Tail protection of all streams, see StreamEncoder::setTailProtection().
+    // Returns how many repair blocks were built, less the blocks then dropped
+    // by the queue limits.
+    int poll( uint64_t nowNs );
+
+    // Bounds the encoded blocks waiting over all streams, on top of the limits
+    // of each stream. Blocks are dropped from the stream holding the most.
+    void setQueueLimits( const QueueLimits& limits );
+
+    // Bytes held by all streams, see StreamEncoder::memoryUse()
+    size_t memoryUse();
+
+    // Time spent in addData()
+    const LatencyHistogram& encodeLatency();
+
 private:
+    bool isAccepting( StreamEncoder* encoder );
+    int enforceLimits();
+    size_t queuedCount();
+    size_t queuedBytes();
+
     std::map< uint8_t, StreamEncoder* > _encoders;
     uint32_t _curGlobalIdx;
+    QueueLimits _limits;
+
+    LatencyHistogram _encodeLatency;
 
 protected:
 
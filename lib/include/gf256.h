@@ -50,22 +50,38 @@
 
 //------------------------------------------------------------------------------
 // Platform/Architecture
-#ifndef _WIN32
+#if defined(__linux__) && (defined(__arm__) || defined(__aarch64__))
 #define LINUX_ARM
 #endif
 //#define HAVE_ARM_NEON_H
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define GF256_TARGET_X86
+#endif
+
 #if defined(ANDROID) || defined(IOS) || defined(LINUX_ARM)
     #define GF256_TARGET_MOBILE
 #endif // ANDROID
 
-#if defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900)
-    #define GF256_TRY_AVX2 /* 256-bit */
+// On x86, kernels for each instruction set are built with function-specific
+// target options, and gf256_init() selects the fastest one the host supports:
+// a portable build does not need -mavx2 to use AVX2.
+#if defined(GF256_TARGET_X86) && !defined(GF256_TARGET_MOBILE)
+    #if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+        #define GF256_TRY_AVX2 /* 256-bit */
+    #endif
+    #if (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8) || (defined(__clang__) && __clang_major__ >= 7) || (defined(_MSC_VER) && _MSC_VER >= 1920)
+        #define GF256_TRY_AVX512 /* 512-bit, AVX-512BW */
+        #define GF256_TRY_GFNI /* GF2P8AFFINEQB */
+    #endif
+#endif // GF256_TARGET_X86
+
+#if defined(GF256_TRY_AVX2)
     #include <immintrin.h>
     #define GF256_ALIGN_BYTES 32
-#else // __AVX2__
+#else // GF256_TRY_AVX2
     #define GF256_ALIGN_BYTES 16
-#endif // __AVX2__
+#endif // GF256_TRY_AVX2
 
 #if !defined(GF256_TARGET_MOBILE)
     // Note: MSVC currently only supports SSSE3 but not AVX2
@@ -150,6 +166,10 @@ struct gf256_ctx
         GF256_ALIGNED GF256_M256 TABLE_HI_Y[256];
     } MM256;
 #endif // GF256_TRY_AVX2
+#ifdef GF256_TRY_GFNI
+    // Multiplication by y as an 8x8 bit matrix, in GF2P8AFFINEQB layout
+    uint64_t GFNI_AFFINE_Y[256];
+#endif // GF256_TRY_GFNI
 
     // Mul/Div/Inv/Sqr tables
     uint8_t GF256_MUL_TABLE[256 * 256];
@@ -239,6 +259,11 @@ static GF256_FORCE_INLINE uint8_t gf256_sqr(uint8_t x)
 extern void gf256_add_mem(void * GF256_RESTRICT vx,
                           const void * GF256_RESTRICT vy, int bytes);
 
+// Performs "x[k][] += y[]" for each k < count: y is read once for all the
+// outputs, instead of once per output. Outputs must not overlap y or each other.
+extern void gf256_addn_mem(void * const * vx, int count,
+                           const void * GF256_RESTRICT vy, int bytes);
+
 // Performs "z[] += x[] + y[]" bulk memory operation
 extern void gf256_add2_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
                            const void * GF256_RESTRICT vy, int bytes);
@@ -264,6 +289,38 @@ static GF256_FORCE_INLINE void gf256_div_mem(void * GF256_RESTRICT vz,
 }
 
 
+//------------------------------------------------------------------------------
+// CPU Features
+
+#if defined(GF256_TARGET_X86)
+// Runs the cpuid instruction, so other modules can share the feature detection
+extern void gf256_cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type);
+#endif // GF256_TARGET_X86
+
+// Code paths of the bulk memory operations, from slowest to fastest
+typedef enum
+{
+    GF256_SIMD_PORTABLE = 0, // 64-bit words
+    GF256_SIMD_NEON,
+    GF256_SIMD_SSSE3,
+    GF256_SIMD_AVX2,
+    GF256_SIMD_AVX2_GFNI,    // AVX2, with GFNI multiplication
+    GF256_SIMD_AVX512,       // AVX-512BW
+    GF256_SIMD_AVX512_GFNI,  // AVX-512BW, with GFNI multiplication
+    GF256_SIMD_PATH_COUNT
+} gf256_simd_path;
+
+// Code path in use: gf256_init() selects the fastest one supported by the host
+extern gf256_simd_path gf256_get_simd_path();
+
+// Short name of a code path, e.g. "avx2"
+extern const char * gf256_simd_path_name(gf256_simd_path path);
+
+// Forces a code path, e.g. to compare them in benchmarks. Returns 0 on success,
+// and -1 if the path is not built in, or not supported by the host.
+extern int gf256_set_simd_path(gf256_simd_path path);
+
+
 //------------------------------------------------------------------------------
 // Misc Operations
 
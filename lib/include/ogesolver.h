@@ -1,15 +1,19 @@
 #pragma once
 
+#include "blockarena.h"
 #include "codeblock.h"
+#include "composition.h"
 #include "sourceblock.h"
 #include "decodeoutput.h"
+#include "gf256.h"
 #include "profiler.h"
 
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <sstream>
-#include <stack>
+#include <deque>
+#include <limits>
 #include <fstream>
 #include <iterator>
 
@@ -23,12 +27,17 @@ using namespace std;
 // #define DEBUG_ORDER
 // #define USE_LOG
 
+// Payload XORs of a burst are applied in column tiles, small enough for the
+// tiles of every buffer involved to stay in L2 cache
+static const int OGE_TILE_CACHE_BYTES = 256 * 1024;
+static const int OGE_MIN_TILE_BYTES = 1024;
+
 class OGESolver
 {
 public:
 
     OGESolver( int decodingWindowSize )
-        :_decodingWindowSize(decodingWindowSize)
+        :_decodingWindowSize(decodingWindowSize), _lazyPayloads(false), _arenaCursor(0), _workBudget(0), _inactivation(false)
     {
         reset();
 #ifdef DEBUG_ORDER
@@ -44,175 +53,172 @@ public:
     void addBlock( std::shared_ptr< CodeBlock > cb )
     {
 
-#ifdef USE_PROFILING
-        $
-        #endif
+        TREVI_TRACE_SCOPE();
 
-        std::set< uint32_t > compo = cb->getCompositionSet();
-        // cerr << "new input: " << endl;
-        // printSet( compo );
-        stringstream sstr;
-        sstr << "{{{{{{{{{{{{{{{{{{{{{{ " << (int)cb->get_stream_sequence_idx() << endl;
+        // Rows are kept normalized: offset is the smallest index
+        Equation eq;
+        eq.components = cb->composition();
+        eq.components.normalize();
+        eq.systematic = eq.components.size() == 1;
 #ifdef DEBUG_ORDER
-        _ofs << sstr.str();
-#endif
-        std::vector <uint32_t> compoVec;
-        std::copy(compo.begin(), compo.end(), std::back_inserter(compoVec));
-
-        std::vector<uint32_t> before = unique_blocks();
-        addEquation( compoVec, cb->clone() );
-        std::vector<uint32_t> after = unique_blocks();
-        std::vector<uint32_t> diff;
-        std::set_difference(after.begin(), after.end(), before.begin(), before.end(),
-                            std::inserter(diff, diff.begin()));
-
-#ifdef USE_LOG
-        cerr << "*** NEW DECODED BLOCKS AFTER OGE:" << endl;
-        printVector( diff );
-#endif
-
-#ifdef USE_LOG
-        cerr << "AFTER OGE:" << endl;
-        cerr << str() << endl;
-        cerr << "****" << endl;
+        _ofs << "{{{{{{{{{{{{{{{{{{{{{{ " << (int)cb->get_stream_sequence_idx() << endl;
 #endif
+        if( _lazyPayloads )
+        {
+            // Received blocks are never modified in lazy mode, no need to copy them
+            eq.terms.push_back( cb );
+        }
+        else
+        {
+            eq.blk = cb->clone( _arena.get(), _arenaCursor++ );
+        }
+        _pendingBytes += equationBytes( eq );
+        _pending.push_back( eq );
 
-        bpPass( after );
-        after = unique_blocks();
-        std::set_difference(after.begin(), after.end(), before.begin(), before.end(),
-                            std::inserter(diff, diff.begin()));
+        run( _workBudget );
+    }
 
-#ifdef USE_LOG
-        cerr << "*** NEW DECODED BLOCKS AFTER BP PASS:" << endl;
-#endif
+    // Performs up to budget row operations (0: no limit) of the pending work:
+    // propagation of decoded blocks first, then elimination of received blocks,
+    // in arrival order, then with inactivation and no budget, the dense core.
+    // Blocks decoded meanwhile are appended to _output.
+    // Returns the number of row operations performed.
+    int run( int budget )
+    {
 
-        removeDups( diff );
+        TREVI_TRACE_SCOPE();
 
-#ifdef USE_LOG
-        printVector( diff );
-#endif
+        int steps = 0;
+        while( budget <= 0 || steps < budget )
+        {
+            int left = budget <= 0 ? std::numeric_limits<int>::max() : budget - steps;
+            if( !_propagations.empty() )
+            {
+                steps += propagateStep( left );
+            }
+            else if( _inflightActive )
+            {
+                steps += eliminateStep();
+            }
+            else if( !_pending.empty() )
+            {
+                _inflight = _pending.front();
+                _pending.pop_front();
+                _pendingBytes -= equationBytes( _inflight );
+                _inflightActive = true;
+            }
+            else if( _inactivation && _coreDirty && budget <= 0 )
+            {
+                // Not resumable: only done by unbounded calls
+                steps += solveCore();
+            }
+            else
+            {
+                break;
+            }
+        }
 
 #ifdef USE_LOG
-        cerr << "*************************************" << endl;
-        cerr << "AFTER BP PASS:" << endl;
+        cerr << "AFTER RUN:" << endl;
         cerr << str() << endl;
         cerr << "****" << endl;
 #endif
 
-        {
-#ifdef USE_PROFILING
-    $
-#endif
-            // cerr << "diff.size()=" << diff.size() << endl;
+        applyPayloadOps();
+        emitOutputs();
+        return steps;
+    }
 
-            for( int k = 0; k < diff.size(); ++k )
-            {
-                std::shared_ptr< CodeBlock > cb = _blocks[ diff[k] - _curOffset ];
-                std::shared_ptr<SourceBlock> sb = std::make_shared<SourceBlock>( cb->payload_size(), (uint8_t*)cb->payload_ptr() );
-                uint32_t idx = diff[k];
-                DecodeOutput doutput;
-                doutput.block = sb;
-                doutput.stream_idx = idx;
-                doutput.global_idx = sb->get_global_sequence_idx();
-                _output.push_back( doutput );
-            }
-        }
+    // Maximum number of row operations per addBlock() call, 0 for no limit.
+    // Work left over is deferred to the next addBlock() or run() call.
+    void setWorkBudget( int budget )
+    {
+        _workBudget = budget;
     }
 
-    void addEquation( std::vector<uint32_t> components, std::shared_ptr<CodeBlock> blk )
+    // Deferred work items: received blocks not fully eliminated yet, decoded
+    // blocks not propagated to every row yet, and the dense core to solve
+    int backlog()
     {
+        return (int)_pending.size() + (_inflightActive ? 1 : 0) + (int)_propagations.size() + (_inactivation && _coreDirty ? 1 : 0);
+    }
 
-#ifdef USE_PROFILING
-        $
-#endif
+    // Received blocks whose elimination was deferred until the window had
+    // moved past them, since the last call
+    int takeExpiredCount()
+    {
+        int ret = _expired;
+        _expired = 0;
+        return ret;
+    }
+
+    // Received blocks waiting for elimination, and their bytes
+    int pendingCount()
+    {
+        return (int)_pending.size();
+    }
 
-        int s = -1;
-        int componentSize = (int)components.size();
-        int component0 = components[0];
-        int component0MinusOffset = components[0] - _curOffset;
+    size_t pendingBytes()
+    {
+        return _pendingBytes;
+    }
 
-        if( component0MinusOffset < 0 )
+    // Drops the oldest received block waiting for elimination, or the oldest
+    // repair block if repairFirst and there is one. False if none is waiting.
+    bool dropPending( bool repairFirst )
+    {
+        if( _pending.empty() )
         {
-            cerr << "wront ! component0MinusOffset = " << component0MinusOffset << endl;
-            return;
+            return false;
         }
-
-        int coeffsCompo0 = (int)_coeffs[ components[0] - _curOffset ].size();
-#ifdef USE_LOG
-        cerr << "components.size()=" << components.size() << " components[0] - _curOffset=" << components[0] - _curOffset <<" - _coeffs[ components[0] ].size()=" << _coeffs[ components[0] - _curOffset ].size() << endl;
-#endif
-        while( components.size() > 0 && _coeffs[ components[0] - _curOffset ].size() > 0 )
+        auto victim = _pending.begin();
+        if( repairFirst )
         {
-            int s = components[0];
-            if( components.size() >= _coeffs[s - _curOffset].size() )
+            auto repair = std::find_if( _pending.begin(), _pending.end(), []( const Equation& eq ) { return !eq.systematic; } );
+            if( repair != _pending.end() )
             {
-                if( xorRow( s, components, blk ) )
-                {
-                    // cerr << "ok good. RECOVERED: " << components[0] << endl;
-                }
-                //                cerr << "xorRow( " << s << ", components, blk )" << endl;
-                //                dump();
-                //                cerr << "xor done." << endl;
-                //                int popo;
-                //                cin >> popo;
+                victim = repair;
             }
-            else
-            {
-                // Swap the existing rwo for the new one, reduce the existing one
-                // and see if it fits elsewhere
-#ifdef USE_LOG
-                cerr << "swap()" << endl;
-                dump();
-#endif
-                std::swap( components, _coeffs[s - _curOffset] );
-                std::swap( _blocks[s - _curOffset ], blk );
-            }
-        }
-
-        if( components.size() > 0 )
-        {
-            _coeffs[ components[0] - _curOffset ] = components;
-            _blocks[ components[0] - _curOffset ] = blk;
         }
-
-        //  dump_good_blocks();
-
+        _pendingBytes -= equationBytes( *victim );
+        _pending.erase( victim );
+        return true;
     }
 
-    bool xorRow( int s, std::vector<uint32_t>& indices, std::shared_ptr<CodeBlock> block )
+    // Bytes of the blocks held by the rows of the window and by the deferred
+    // work. Blocks shared by several rows (lazy mode) are counted once per row.
+    size_t memoryUse()
     {
-
-#ifdef USE_PROFILING
-        $
-#endif
-
-        std::vector<uint32_t> newIndices;
-        std::vector<uint32_t> coeffs = _coeffs[s - _curOffset];
-        int i = 0;
-        int j = 0;
-        while( i < coeffs.size() && j < indices.size() )
+        size_t ret = _pendingBytes + (_inflightActive ? equationBytes( _inflight ) : 0);
+        for( size_t k = 0; k < _blocks.size(); ++k )
         {
-            int index = indices[j];
-            if( coeffs[i] == index )
+            if( _blocks[k] )
             {
-                i++;
-                j++;
-            } else if( (int)coeffs[i] < index )
+                ret += _blocks[k]->buffer_size();
+            }
+            for( const std::shared_ptr< CodeBlock >& t : _terms[k] )
             {
-                newIndices.push_back(coeffs[i]);
-                i++;
-            } else {
-                newIndices.push_back( index );
-                j++;
+                ret += t->buffer_size();
             }
         }
+        return ret;
+    }
 
-        newIndices.insert( newIndices.end(), coeffs.begin() + i, coeffs.end() );
-        newIndices.insert( newIndices.end(), indices.begin() + j, indices.end() );
+    bool xorRow( int s, Composition& indices, std::shared_ptr<CodeBlock>& block, std::vector< std::shared_ptr<CodeBlock> >& terms )
+    {
 
-        // return newIndices, b
-        indices = newIndices;
-        block->XOR_payload( _blocks[s - _curOffset] );
+        TREVI_TRACE_SCOPE();
+
+        // Both rows start at s, so s cancels out and the result stays normalized
+        indices.xorWith( _coeffs[s - _curOffset] );
+        if( _lazyPayloads )
+        {
+            xorTerms( terms, _terms[s - _curOffset] );
+        }
+        else
+        {
+            schedulePayloadXor( block, _blocks[s - _curOffset] );
+        }
 
         return (indices.size() == 1);
     }
@@ -222,7 +228,7 @@ public:
         int cpt = 0;
         for( int i = 0; i < _coeffs.size(); ++i )
         {
-            if( _coeffs[i].size() == 0 )
+            if( _coeffs[i].empty() )
                 cpt++;
         }
         return cpt;
@@ -236,9 +242,9 @@ public:
         for( int i = 0; i < _coeffs.size(); ++i )
         {
             sstr << " [ ";
-            for( int j = 0; j < _coeffs[i].size(); ++j )
+            for( uint32_t idx : _coeffs[i] )
             {
-                sstr << _coeffs[i][j] << ",";
+                sstr << idx << ",";
             }
             sstr << "], ";
         }
@@ -265,6 +271,81 @@ public:
         }
     }
 
+    // In lazy mode, elimination only works on coefficients: each row records the
+    // received blocks whose XOR gives its payload, and payloads are only XORed
+    // when the row decodes to a single source.
+    void setLazyPayloads( bool lazy )
+    {
+        _lazyPayloads = lazy;
+    }
+
+    bool lazyPayloads()
+    {
+        return _lazyPayloads;
+    }
+
+    // Rows left undetermined by elimination and propagation may still combine
+    // into decoded blocks: with inactivation, they are solved as a dense core
+    // whenever the rank grows, see solveCore()
+    void setInactivation( bool inactivation )
+    {
+        _inactivation = inactivation;
+    }
+
+    // Payloads computed by the solver go to the slots of this arena, in turn
+    void setBlockArena( std::shared_ptr< BlockArena > arena )
+    {
+        _arena = arena;
+    }
+
+    // True if every source block of compo is in the window and already decoded:
+    // a block with this composition cannot bring anything new
+    bool isSolved( const Composition& compo )
+    {
+        if( compo.empty() )
+        {
+            return false;
+        }
+        for( uint32_t idx : compo )
+        {
+            if( !isDecoded( idx ) )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // True if source block idx is in the window and decoded
+    bool isDecoded( uint32_t idx )
+    {
+        return idx - _curOffset < _coeffs.size() && _coeffs[ idx - _curOffset ].size() == 1;
+    }
+
+    // Number of independent equations currently held in the window
+    int rank()
+    {
+        return _rank;
+    }
+
+    // Number of source blocks in [from, to) which are not decoded yet,
+    // indices beyond the window being undecoded by definition
+    int undecodedCount( uint32_t from, uint32_t to )
+    {
+        int cpt = 0;
+        for( int i = 0; i < (int)_coeffs.size() && seq_before( _curOffset + i, to ); ++i )
+        {
+            if( !seq_before( _curOffset + i, from ) && _coeffs[i].size() != 1 )
+                cpt++;
+        }
+        uint32_t windowEnd = seq_max( from, _curOffset + (uint32_t)_coeffs.size() );
+        if( seq_before( windowEnd, to ) )
+        {
+            cpt += to - windowEnd;
+        }
+        return cpt;
+    }
+
     void setOffset( uint32_t offset )
     {
         _curOffset = offset;
@@ -278,32 +359,47 @@ public:
     void reset()
     {
         _curOffset = 0;
+        _rank = 0;
         const int pol = _decodingWindowSize;
-        _coeffs = std::vector< std::vector<uint32_t> >(pol);
+        _coeffs = std::vector< Composition >(pol);
         _blocks = std::vector< std::shared_ptr< CodeBlock > >(pol);
+        _terms = std::vector< std::vector< std::shared_ptr< CodeBlock > > >(pol);
+        _pending.clear();
+        _pendingBytes = 0;
+        _inflightActive = false;
+        _propagations.clear();
+        _decoded.clear();
+        _payloadOps.clear();
+        _coreDirty = false;
+        _expired = 0;
     }
 
     void shiftWindowTo( uint32_t minValue )
     {
 
-#ifdef USE_PROFILING
-        $
-#endif
+        TREVI_TRACE_SCOPE();
 
-        int n = minValue - _curOffset;
+        int n = (int32_t)(minValue - _curOffset);
         // cerr << "n=" << n << " minValue=" << minValue << " _curOffset=" << _curOffset << endl;
         for( int k = 0; k < n && _coeffs.size() > 0; ++k )
         {
             // cerr << "_coeffs.size()=" << _coeffs.size() << endl;
+            if( !_coeffs.front().empty() )
+            {
+                _rank--;
+            }
             _coeffs.erase( _coeffs.begin() );
             _blocks.erase( _blocks.begin() );
+            _terms.erase( _terms.begin() );
         }
 
-        std::vector<uint32_t> nv;
+        Composition nv;
+        std::vector< std::shared_ptr< CodeBlock > > nt;
         for( int k = 0; k < min(_decodingWindowSize, n); ++k )
         {
             _coeffs.push_back(nv);
             _blocks.push_back(nullptr);
+            _terms.push_back(nt);
         }
 
         _curOffset = minValue;
@@ -312,108 +408,517 @@ public:
 
     std::vector< uint32_t > unique_blocks()
     {
-#ifdef USE_PROFILING
-    $
-#endif
+        TREVI_TRACE_SCOPE();
             // cerr << "unique_blocks: n = " << _coeffs.size() << endl;
 
         std::vector< uint32_t > ret;
-        for( std::vector< uint32_t > vv : _coeffs )
+        for( const Composition& vv : _coeffs )
         {
             if( vv.size() == 1 )
             {
-                ret.push_back( vv[0] );
+                ret.push_back( vv.front() );
             }
         }
         return ret;
     }
 
-    std::vector< uint32_t > propagateBelief( uint32_t blockIdx )
+    std::vector< DecodeOutput > _output;
+
+private:
+    struct CodeBlockPtrLess
     {
+        inline bool operator() ( const std::shared_ptr<CodeBlock>& a, const std::shared_ptr<CodeBlock>& b ) const
+        {
+            return std::less< CodeBlock* >()( a.get(), b.get() );
+        }
+    };
 
-#ifdef USE_PROFILING
-        $
-        #endif
+    // A received block, as an equation over the source blocks
+    struct Equation
+    {
+        Composition components;
+        std::shared_ptr<CodeBlock> blk;                     // Eager mode payload
+        std::vector< std::shared_ptr<CodeBlock> > terms;    // Lazy mode payload
+        bool systematic;                                    // Received as a single source block
+    };
 
-                std::vector< uint32_t > ret;
-        std::shared_ptr< CodeBlock > cb = _blocks[ blockIdx - _curOffset ];
+    static size_t equationBytes( const Equation& eq )
+    {
+        size_t ret = eq.blk ? eq.blk->buffer_size() : 0;
+        for( const std::shared_ptr< CodeBlock >& t : eq.terms )
+        {
+            ret += t->buffer_size();
+        }
+        return ret;
+    }
 
-        // Loop through all coeffs
-        for( int i = 0; i < _coeffs.size(); ++i )
+    // Decoded block which still has to be XORed out of the rows starting at
+    // nextIdx and after (absolute indices, as the window may move meanwhile)
+    struct Propagation
+    {
+        uint32_t blockIdx;
+        uint32_t nextIdx;
+    };
+
+    struct Decoded
+    {
+        uint32_t blockIdx;
+        bool recovered;
+    };
+
+    // One row operation on the received block being eliminated. Rows only hold
+    // their own decoded block: decoded blocks are removed from the equation
+    // first, then rows sharing its smallest index are XORed in, until it fits
+    // in an empty row or vanishes.
+    int eliminateStep()
+    {
+
+        TREVI_TRACE_SCOPE();
+
+        Equation& eq = _inflight;
+        if( eq.components.empty() )
         {
-            // Try to find a composed block containing blockIdx
-            if( _coeffs[i].size() > 1 )
+            _inflightActive = false;
+            return 0;
+        }
+
+        int row = (int32_t)(eq.components.front() - _curOffset);
+        if( row < 0 || row >= (int)_coeffs.size() )
+        {
+            // The window moved past it while it was waiting
+            _expired++;
+            _inflightActive = false;
+            return 0;
+        }
+
+        for( uint32_t idx : eq.components )
+        {
+            if( idx != eq.components.front() && isDecoded( idx ) )
             {
-                if(std::find(_coeffs[i].begin(), _coeffs[i].end(), blockIdx) != _coeffs[i].end())
-                {
-#ifdef USE_LOG
-                    printVector( _coeffs[i] );
-                    cerr << "---- contains " << blockIdx << endl;
-#endif
-                    // Do something - XOR the block blockIdx from the found block
-                    std::shared_ptr< CodeBlock > block = _blocks[ i ];
-                    block->XOR_payload( cb );
+                eq.components.erase( idx );
+                xorPayload( eq.blk, eq.terms, idx - _curOffset );
+                return 1;
+            }
+        }
+
+        if( _coeffs[ row ].empty() )
+        {
+            _coeffs[ row ] = eq.components;
+            _blocks[ row ] = eq.blk;
+            _terms[ row ] = eq.terms;
+            _rank++;
+            _coreDirty = true;
+            _inflightActive = false;
+            if( eq.components.size() == 1 )
+            {
+                onRowDecoded( row, eq.systematic );
+            }
+            return 0;
+        }
+
+        if( eq.components.size() >= _coeffs[ row ].size() )
+        {
+            xorRow( eq.components.front(), eq.components, eq.blk, eq.terms );
+            return 1;
+        }
 
+        // Swap the existing row for the new one, and go on reducing the existing one
 #ifdef USE_LOG
-                    cerr << "propagating " <<  blockIdx << " to..." << endl;
-                    cerr << "before:" << endl;
-                    printVector( _coeffs[i] );
+        cerr << "swap()" << endl;
+        dump();
 #endif
+        std::swap( eq.components, _coeffs[ row ] );
+        std::swap( eq.blk, _blocks[ row ] );
+        std::swap( eq.terms, _terms[ row ] );
+        bool systematic = eq.systematic;
+        eq.systematic = false;
+        if( _coeffs[ row ].size() == 1 )
+        {
+            onRowDecoded( row, systematic );
+        }
+        return 1;
+    }
 
-                    // Remove reference from coeffs..
-                    _coeffs[i].erase(std::remove(_coeffs[i].begin(), _coeffs[i].end(), blockIdx), _coeffs[i].end());
+    // XORs the decoded block on top of the propagation stack out of the rows
+    // holding it, at most maxSteps of them
+    int propagateStep( int maxSteps )
+    {
+
+        TREVI_TRACE_SCOPE();
 
+        Propagation& p = _propagations.back();
+        uint32_t blockIdx = p.blockIdx;
+        if( seq_before( blockIdx, _curOffset ) )
+        {
+            _propagations.pop_back(); // Left the window
+            return 0;
+        }
+
+        // Only rows starting less than MAX_SPAN blocks before can hold it
+        int src = blockIdx - _curOffset;
+        int row = std::max( (int)(seq_max( p.nextIdx, _curOffset ) - _curOffset), src - (Composition::MAX_SPAN - 1) );
+        int steps = 0;
+        _newlyDecodedRows.clear();
+        for( ; row < src && steps < maxSteps; ++row )
+        {
+            if( _coeffs[ row ].size() > 1 && _coeffs[ row ].contains( blockIdx ) )
+            {
 #ifdef USE_LOG
-                    cerr << "after:" << endl;
-                    printVector( _coeffs[i] );
+                cerr << "propagating " << blockIdx << " to " << _coeffs[ row ].str() << endl;
 #endif
+                xorPayload( _blocks[ row ], _terms[ row ], src );
+                // blockIdx is never the smallest index of the row, which therefore stays normalized
+                _coeffs[ row ].erase( blockIdx );
+                steps++;
+                if( _coeffs[ row ].size() == 1 )
+                {
+                    _newlyDecodedRows.push_back( row );
+                }
+            }
+        }
+
+        if( row >= src )
+        {
+            _propagations.pop_back();
+        }
+        else
+        {
+            p.nextIdx = _curOffset + row;
+        }
+        for( int decodedRow : _newlyDecodedRows )
+        {
+            onRowDecoded( decodedRow, false );
+        }
+        return steps;
+    }
+
+    // Inactivation decoding of the undetermined rows, once elimination and
+    // propagation are done. Rows are triangular: each one starts at its own
+    // index (its pivot), and decoded indices are gone from the others. The
+    // indices without a row are inactivated. Going back from the last row,
+    // each row is reduced by the rows of its other pivots, which leaves its
+    // pivot plus a combination of inactive indices, kept as a bitmask; rows
+    // where that combination cancels out are decoded. Each row also tracks
+    // which rows it was reduced by, to build the decoded payloads.
+    // Returns the number of payload XORs performed, charged as row operations.
+    int solveCore()
+    {
+
+        TREVI_TRACE_SCOPE();
+
+        _coreDirty = false;
+
+        // Rows may reach MAX_SPAN - 1 indices beyond the window
+        const int n = (int)_coeffs.size();
+        _coreId.assign( n + Composition::MAX_SPAN, -1 );
+        _inactiveId.assign( n + Composition::MAX_SPAN, -1 );
+        int coreRows = 0;
+        int inactives = 0;
+        for( int i = 0; i < n; ++i )
+        {
+            if( _coeffs[ i ].size() > 1 )
+            {
+                _coreId[ i ] = coreRows++;
+            }
+        }
+        if( coreRows == 0 )
+        {
+            return 0;
+        }
+        for( int i = 0; i < n; ++i )
+        {
+            if( _coreId[ i ] < 0 )
+            {
+                continue;
+            }
+            for( uint32_t idx : _coeffs[ i ] )
+            {
+                int col = idx - _curOffset;
+                if( col < n && !_coeffs[ col ].empty() && _coreId[ col ] < 0 )
+                {
+                    return 0; // Decoded index not propagated yet, cannot happen here
+                }
+                if( _coreId[ col ] < 0 && _inactiveId[ col ] < 0 )
+                {
+                    _inactiveId[ col ] = inactives++;
+                }
+            }
+        }
 
-                    // Check if codeblock has been fully decoded
-                    if( _coeffs[i].size() == 1 )
+        // Per row: inactive indices, then rows combined
+        const int inactiveWords = (inactives + 63) / 64;
+        const int stride = inactiveWords + (coreRows + 63) / 64;
+        _coreMasks.assign( (size_t)stride * coreRows, 0 );
+        for( int i = n - 1; i >= 0; --i )
+        {
+            int id = _coreId[ i ];
+            if( id < 0 )
+            {
+                continue;
+            }
+            uint64_t* mask = &_coreMasks[ (size_t)id * stride ];
+            mask[ inactiveWords + id / 64 ] |= (uint64_t)1 << (id % 64);
+            for( uint32_t idx : _coeffs[ i ] )
+            {
+                int col = idx - _curOffset;
+                if( col == i )
+                {
+                    continue;
+                }
+                if( _inactiveId[ col ] >= 0 )
+                {
+                    mask[ _inactiveId[ col ] / 64 ] ^= (uint64_t)1 << (_inactiveId[ col ] % 64);
+                }
+                else
+                {
+                    const uint64_t* other = &_coreMasks[ (size_t)_coreId[ col ] * stride ];
+                    for( int w = 0; w < stride; ++w )
                     {
-                        ret.push_back( _coeffs[i][0] );
+                        mask[ w ] ^= other[ w ];
                     }
                 }
             }
         }
-        return ret;
+
+        // Payloads are built from the rows as they are, before any of them changes
+        _newlyDecodedRows.clear();
+        _coreBlocks.clear();
+        _coreTerms.clear();
+        int xors = 0;
+        for( int i = 0; i < n; ++i )
+        {
+            int id = _coreId[ i ];
+            if( id < 0 )
+            {
+                continue;
+            }
+            const uint64_t* mask = &_coreMasks[ (size_t)id * stride ];
+            bool solved = true;
+            for( int w = 0; w < inactiveWords && solved; ++w )
+            {
+                solved = mask[ w ] == 0;
+            }
+            if( !solved )
+            {
+                continue;
+            }
+
+            std::shared_ptr<CodeBlock> block;
+            std::vector< std::shared_ptr<CodeBlock> > terms;
+            if( !_lazyPayloads )
+            {
+                block = std::make_shared<CodeBlock>( _blocks[ i ]->payload_size(), _arena.get(), _arenaCursor++ );
+            }
+            for( int j = 0; j < n; ++j )
+            {
+                int other = _coreId[ j ];
+                if( other >= 0 && ((mask[ inactiveWords + other / 64 ] >> (other % 64)) & 1) )
+                {
+                    xorPayload( block, terms, j );
+                    xors++;
+                }
+            }
+            _newlyDecodedRows.push_back( i );
+            _coreBlocks.push_back( block );
+            _coreTerms.push_back( terms );
+        }
+
+        std::vector< int > decodedRows;
+        decodedRows.swap( _newlyDecodedRows );
+        for( size_t k = 0; k < decodedRows.size(); ++k )
+        {
+            int row = decodedRows[ k ];
+            _coeffs[ row ] = Composition( _curOffset + row, 1 );
+            _blocks[ row ] = _coreBlocks[ k ];
+            _terms[ row ] = _coreTerms[ k ];
+        }
+        for( int row : decodedRows )
+        {
+            onRowDecoded( row, false );
+        }
+        _coreBlocks.clear();
+        _coreTerms.clear();
+        return xors;
+    }
+
+    void onRowDecoded( int row, bool systematic )
+    {
+        if( _lazyPayloads )
+        {
+            materialize( row );
+        }
+        Propagation p = { _curOffset + row, _curOffset };
+        _propagations.push_back( p );
+        Decoded d = { _curOffset + row, !systematic };
+        _decoded.push_back( d );
+    }
+
+    // block ^= payload of row, in eager or lazy mode
+    void xorPayload( std::shared_ptr<CodeBlock>& block, std::vector< std::shared_ptr<CodeBlock> >& terms, int row )
+    {
+        if( _lazyPayloads )
+        {
+            xorTerms( terms, _terms[ row ] );
+        }
+        else
+        {
+            schedulePayloadXor( block, _blocks[ row ] );
+        }
     }
 
-    void bpPass( std::vector< uint32_t > initialList )
+    // Payloads must be up to date: called after applyPayloadOps()
+    void emitOutputs()
     {
 
-#ifdef USE_PROFILING
-        $
-        #endif
+        TREVI_TRACE_SCOPE();
 
-                std::stack< uint32_t > s;
-        // Initialize stack of blocks to propagate
-        for( uint32_t v : initialList )
+        for( const Decoded& d : _decoded )
         {
-            s.push( v );
+            // Decoded rows are never modified again, so the output can
+            // directly point into the solver buffer instead of copying it.
+            std::shared_ptr< CodeBlock > cb = _blocks[ d.blockIdx - _curOffset ];
+            std::shared_ptr<SourceBlock> sb = std::make_shared<SourceBlock>( cb->payload_ref(), cb->payload_size() );
+            DecodeOutput doutput;
+            doutput.block = sb;
+            doutput.stream_idx = d.blockIdx;
+            doutput.global_idx = sb->get_global_sequence_idx();
+            doutput.decode_time_ns = 0;
+            doutput.recovered = d.recovered;
+            _output.push_back( doutput );
         }
+        _decoded.clear();
+    }
+
+    // terms ^= other: XORing a block twice cancels it, hence the symmetric difference
+    void xorTerms( std::vector< std::shared_ptr<CodeBlock> >& terms, const std::vector< std::shared_ptr<CodeBlock> >& other )
+    {
+        std::vector< std::shared_ptr<CodeBlock> > res;
+        res.reserve( terms.size() + other.size() );
+        std::set_symmetric_difference( terms.begin(), terms.end(), other.begin(), other.end(),
+                                       std::back_inserter( res ), CodeBlockPtrLess() );
+        terms.swap( res );
+    }
+
+    // Compute the payload of a decoded row from its terms (lazy mode only)
+    void materialize( int row )
+    {
 
-        while( s.size() > 0 )
+        TREVI_TRACE_SCOPE();
+
+        std::vector< std::shared_ptr<CodeBlock> >& terms = _terms[ row ];
+        if( terms.size() == 1 )
+        {
+            _blocks[ row ] = terms[0];
+        }
+        else
         {
-            uint32_t next = s.top();
-            s.pop();
-            std::vector< uint32_t > rv = propagateBelief(next);
-            for( auto vrv : rv )
+            int plSize = 0;
+            for( const std::shared_ptr<CodeBlock>& t : terms )
+            {
+                plSize = std::max( plSize, (int)t->payload_size() );
+            }
+            std::shared_ptr<CodeBlock> block = std::make_shared<CodeBlock>( plSize, _arena.get(), _arenaCursor++ );
+            for( const std::shared_ptr<CodeBlock>& t : terms )
             {
-                s.push( vrv );
+                schedulePayloadXor( block, t );
             }
+            _blocks[ row ] = block;
+            terms = std::vector< std::shared_ptr<CodeBlock> >( 1, block );
+        }
+    }
+
+    // Elimination only decides which payloads are XORed together: the XORs are
+    // recorded here, in order, and applied by applyPayloadOps()
+    struct PayloadOp
+    {
+        std::shared_ptr<CodeBlock> dst;
+        std::shared_ptr<CodeBlock> src;
+        uint8_t* dstPtr;
+        const uint8_t* srcPtr;
+        int bytes;
+    };
+
+    // dst ^= src. A shorter dst is first replaced by a zero padded copy, so
+    // that the bytes of src beyond it are not lost.
+    void schedulePayloadXor( std::shared_ptr<CodeBlock>& dst, const std::shared_ptr<CodeBlock>& src )
+    {
+        if( src->payload_size() > dst->payload_size() )
+        {
+            std::shared_ptr<CodeBlock> grown = std::make_shared<CodeBlock>( src->payload_size(), _arena.get(), _arenaCursor++ );
+            schedulePayloadXor( grown, dst );
+            dst = grown;
         }
 
+        PayloadOp op;
+        op.dst = dst;
+        op.src = src;
+        op.dstPtr = (uint8_t*)dst->payload_ptr();
+        op.srcPtr = (const uint8_t*)src->payload_ptr();
+        op.bytes = src->payload_size();
+        _payloadOps.push_back( op );
     }
 
-    std::deque< DecodeOutput > _output;
+    // XORs are independent from one byte column to the next, so the whole
+    // schedule can be replayed one column tile at a time: a tile of each buffer
+    // is loaded once per burst, instead of once per XOR involving it.
+    void applyPayloadOps()
+    {
 
-private:
-    std::vector< std::vector<uint32_t> >        _coeffs;
+        TREVI_TRACE_SCOPE();
+
+        int width = 0;
+        for( const PayloadOp& op : _payloadOps )
+        {
+            width = std::max( width, op.bytes );
+        }
+
+        int tile = OGE_TILE_CACHE_BYTES / (2 * std::max( 1, (int)_payloadOps.size() ));
+        tile = std::max( OGE_MIN_TILE_BYTES, tile & ~63 );
+        for( int from = 0; from < width; from += tile )
+        {
+            for( const PayloadOp& op : _payloadOps )
+            {
+                int bytes = std::min( op.bytes - from, tile );
+                if( bytes > 0 )
+                {
+                    gf256_add_mem( op.dstPtr + from, op.srcPtr + from, bytes );
+                }
+            }
+        }
+        _payloadOps.clear();
+    }
+
+    std::vector< Composition >                  _coeffs;
     std::vector< std::shared_ptr<CodeBlock> >   _blocks;
+    std::vector< std::vector< std::shared_ptr<CodeBlock> > > _terms;
+    std::vector< PayloadOp >                    _payloadOps;
+
+    std::deque< Equation >      _pending;           // Received, not eliminated yet
+    size_t                      _pendingBytes;
+    Equation                    _inflight;          // Being eliminated, if _inflightActive
+    bool                        _inflightActive;
+    std::vector< Propagation >  _propagations;      // Stack
+    std::vector< Decoded >      _decoded;           // Since the last emitOutputs()
+    std::vector< int >          _newlyDecodedRows;
+    int                         _expired;           // See takeExpiredCount()
+
+    // solveCore() scratch: core row and inactive index of each window index,
+    // bitmasks of the core rows, and payloads of the rows it decodes
+    std::vector< int >          _coreId;
+    std::vector< int >          _inactiveId;
+    std::vector< uint64_t >     _coreMasks;
+    std::vector< std::shared_ptr<CodeBlock> > _coreBlocks;
+    std::vector< std::vector< std::shared_ptr<CodeBlock> > > _coreTerms;
+    bool                        _coreDirty;         // Rank grew since the last solveCore()
 
     int _decodingWindowSize;
     uint32_t _curOffset;
+    int _rank;
+    bool _lazyPayloads;
+    std::shared_ptr< BlockArena > _arena;
+    uint32_t _arenaCursor;
+    int _workBudget;
+    bool _inactivation;
 
 #ifdef DEBUG_ORDER
     ofstream _ofs;
@@ -1,8 +1,94 @@
 #pragma once
 
+#include <ostream>
+
+#include <cstdint>
+
+// Scoped tracing, enabled with the USE_PROFILING build option.
+//
+// TREVI_TRACE_SCOPE() at the top of a function records one fixed-size event
+// (scope id, start and end timestamps in CPU ticks) into a ring buffer owned by
+// the calling thread: no lock, no allocation and no string work on the hot path.
+// Rings keep the most recent TRACE_RING_SIZE events of each thread; they are
+// only read when exported, by dump_profiling_info() or trace_export_chrome().
+
 #ifdef USE_PROFILING
-#include <dollar.hpp>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TREVI_TRACE_FUNCTION __PRETTY_FUNCTION__
+#else
+#define TREVI_TRACE_FUNCTION __FUNCTION__
 #endif
 
-void dump_profiling_info();
+#define TREVI_TRACE_CONCAT_( a, b ) a##b
+#define TREVI_TRACE_CONCAT( a, b ) TREVI_TRACE_CONCAT_( a, b )
+
+// Scope ids are registered once per call site
+#define TREVI_TRACE_SCOPE_NAMED( name ) \
+    static const uint32_t TREVI_TRACE_CONCAT( _traceScopeId, __LINE__ ) = trace_register_scope( name ); \
+    TraceScope TREVI_TRACE_CONCAT( _traceScope, __LINE__ )( TREVI_TRACE_CONCAT( _traceScopeId, __LINE__ ) )
+
+#define TREVI_TRACE_SCOPE() TREVI_TRACE_SCOPE_NAMED( TREVI_TRACE_FUNCTION )
+
+#else
+
+#define TREVI_TRACE_SCOPE_NAMED( name )
+#define TREVI_TRACE_SCOPE()
+
+#endif
+
+static const int TRACE_RING_SIZE = 1 << 15; // Events, must be a power of two
 
+struct TraceEvent
+{
+    uint64_t start;
+    uint64_t end;
+    uint32_t scopeId;
+    uint32_t depth;
+};
+
+// Returns the id of a scope name, which must outlive the process (a literal)
+uint32_t trace_register_scope( const char* name );
+
+// CPU tick counter used for timestamps
+uint64_t trace_ticks();
+
+// Appends an event to the ring of the calling thread
+void trace_record( uint32_t scopeId, uint64_t start, uint64_t end, uint32_t depth );
+
+// Nesting depth of the calling thread, maintained by TraceScope
+uint32_t& trace_depth();
+
+class TraceScope
+{
+public:
+    explicit TraceScope( uint32_t scopeId )
+        :_scopeId(scopeId), _depth(trace_depth()++), _start(trace_ticks())
+    {
+    }
+
+    ~TraceScope()
+    {
+        uint64_t end = trace_ticks();
+        trace_depth()--;
+        trace_record( _scopeId, _start, end, _depth );
+    }
+
+private:
+    uint32_t _scopeId;
+    uint32_t _depth;
+    uint64_t _start;
+
+    TraceScope( const TraceScope& ) = delete;
+    TraceScope& operator=( const TraceScope& ) = delete;
+};
+
+// Writes the events recorded since the previous export in Chrome trace
+// format (chrome://tracing, Perfetto). Safe to call while other threads trace.
+void trace_export_chrome( std::ostream& os );
+
+// Per scope call count and time, over the events recorded since the previous export
+void trace_export_text( std::ostream& os );
+
+// Writes /tmp/trevi_profiling.json and prints a summary to standard output
+void dump_profiling_info();
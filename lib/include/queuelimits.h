@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// What to do with a queue over its limits
+static const uint8_t DROP_OLDEST_REPAIR = 0;    // Drop repair blocks first, oldest first, then the oldest blocks
+static const uint8_t DROP_OLDEST = 1;           // Drop the oldest blocks
+static const uint8_t DROP_REJECT = 2;           // Drop nothing: new blocks are refused until the queue is drained
+
+// Outcome of handing a block to a bounded queue
+static const int QUEUE_ACCEPTED = 0;
+static const int QUEUE_DROPPED = 1;             // Accepted, older blocks were dropped to make room
+static const int QUEUE_REJECTED = -2;           // Refused (DROP_REJECT), nothing was done
+
+// Capacity of a queue, in blocks, and memory budget of the blocks it holds,
+// in bytes (0: no limit).
+// Limits are enforced after each block is added, so a queue may briefly hold
+// the blocks produced by one call on top of its limits.
+struct QueueLimits
+{
+    QueueLimits()
+        :capacity(0), memoryBudget(0), dropPolicy(DROP_OLDEST_REPAIR)
+    {
+    }
+
+    bool exceeded( size_t count, size_t bytes ) const
+    {
+        return (capacity > 0 && count > (size_t)capacity) || (memoryBudget > 0 && bytes > memoryBudget);
+    }
+
+    // True once there is no room left for another block
+    bool full( size_t count, size_t bytes ) const
+    {
+        return (capacity > 0 && count >= (size_t)capacity) || (memoryBudget > 0 && bytes >= memoryBudget);
+    }
+
+    int capacity;
+    size_t memoryBudget;
+    uint8_t dropPolicy;
+};
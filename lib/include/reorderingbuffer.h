@@ -12,7 +12,7 @@ class ReorderingBuffer
 {
 public:
     ReorderingBuffer( int windowSize )
-        :_windowSize(windowSize)
+        :_windowSize(windowSize), _bytes(0), _lastReleasedIdx(0), _hasReleased(false)
     {
 
     }
@@ -22,19 +22,41 @@ public:
 
     }
 
-    void addBlock( uint32_t stream_idx, uint32_t global_idx, std::shared_ptr< SourceBlock > sb );
+    void addBlock( const DecodeOutput& deco );
+    // Releases every buffered block, in order, and forgets the last released index
+    void flush();
+    // Releases, in order, the blocks decoded at cutoffNs or before, giving up
+    // on the missing blocks before them, then the blocks following the last
+    // released one without gap. Returns the number of blocks released.
+    int release( uint64_t cutoffNs );
 
     bool available();
     std::shared_ptr< SourceBlock > pop();
+    bool pop( DecodeOutput& deco );
+
+    // Drops every block, released or not, and forgets the last released index
+    void clear();
+
+    // Drops the oldest block, released or not. False if there is none.
+    bool dropOldest();
+
+    // Blocks held, released or not, and their bytes
+    size_t size();
+    size_t bytes();
 
 private:
     int _windowSize;
+    size_t _bytes;
 
     std::deque< DecodeOutput > _buffer;
 
-    std::deque< std::shared_ptr< SourceBlock > > _outputQueue;
+    std::deque< DecodeOutput > _outputQueue;
+
+    uint32_t _lastReleasedIdx;
+    bool _hasReleased;
 
-    void insert(uint32_t stream_idx, uint32_t global_idx, std::shared_ptr< SourceBlock > sb );
+    void insert( const DecodeOutput& deco );
+    void releaseFront();
 
     void dump();
 
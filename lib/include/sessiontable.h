@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "decoder.h"
+#include "streamdecoder.h"
+#include "sourceblock.h"
+
+// What the packets of a session have in common: the address they come from
+// (opaque bytes, typically a sockaddr), a session ID given by the application,
+// and the stream ID of their header
+struct SessionKey
+{
+    static const int MAX_ADDRESS_SIZE = 28; // sizeof(sockaddr_in6)
+
+    uint8_t address[ MAX_ADDRESS_SIZE ];
+    uint8_t addressSize;
+    uint8_t streamId;
+    uint32_t sessionId;
+
+    // False if the address is too long
+    bool set( const void* addr, int addrSize, uint32_t session, uint8_t stream );
+
+    uint64_t hash() const;
+    bool operator==( const SessionKey& other ) const;
+};
+
+struct SessionOutput
+{
+    SessionKey key;
+    std::shared_ptr< SourceBlock > block;
+};
+
+// Demultiplexes the packets of many senders, each one decoded by its own
+// decoder, as if it was the only one.
+//
+// Sessions are found through an open addressing hash table (linear probing,
+// at most half full), in O(1) whatever their number. A session, and its
+// decoder, is only created by its first packet, and is evicted once idle for
+// longer than the idle timeout: its decoded packets are still handed out, and
+// the ones it could not decode are lost. Session records live in a pool,
+// recycled after eviction, and so do decoders, up to
+// SPARE_DECODERS_MAX of them. Sessions record neither latencies nor
+// statistics of their own: their statistics go to the table-wide stats().
+class SessionTable
+{
+public:
+    SessionTable( int decodingWindowSize, uint64_t idleTimeoutNs );
+    virtual ~SessionTable();
+
+    // Hands a coded packet to the decoder of its session. Returns false if it
+    // is too short to tell its stream, or if the address is too long.
+    bool addCodeBlock( const void* address, int addressSize, uint32_t sessionId, const void* buffer, int bufferSize, uint64_t nowNs );
+
+    bool available();
+    // Next decoded packet of any session, false if there is none
+    bool pop( SessionOutput& out );
+
+    // Evicts the sessions which received nothing for longer than the idle
+    // timeout. Returns the number of sessions evicted.
+    int evictIdle( uint64_t nowNs );
+
+    // Options of the stream decoders of the sessions created from now on
+    void setLazyPayloads( bool lazy );
+    void setInactivation( bool inactivation );
+    void setWorkBudget( int budget );
+
+    int sessionCount();
+    uint64_t evictedCount();
+    uint64_t droppedMalformedCount();
+
+    // Over every session: counters are sums, gauges are the values of the
+    // session updated last
+    const StreamStats& stats();
+
+private:
+    struct Session
+    {
+        SessionKey key;
+        uint64_t hash;
+        uint64_t lastActiveNs;
+
+        // Sessions from the least to the most recently active, as pool indices (-1: none)
+        int older;
+        int newer;
+
+        // Queued in _ready, having decoded packets to hand out
+        bool ready;
+
+        std::unique_ptr< Decoder > decoder;
+        std::unique_ptr< StreamDecoder > streamDecoder;
+    };
+
+    // Decoders of evicted sessions, reset, for the sessions created next
+    struct SpareDecoder
+    {
+        std::unique_ptr< Decoder > decoder;
+        std::unique_ptr< StreamDecoder > streamDecoder;
+    };
+
+    struct Slot
+    {
+        uint32_t hash;      // Low bits of the session key hash
+        uint32_t session;   // Pool index + 1, 0 if the slot is empty
+    };
+
+    int find( const SessionKey& key, uint64_t hash );
+    int create( const SessionKey& key, uint64_t hash );
+    void evict( int session );
+
+    void insertSlot( uint32_t hash, int session );
+    void eraseSlot( uint32_t hash, int session );
+    void grow();
+
+    void unlink( int session );
+    void pushNewest( int session );
+
+    // Duplicates are only remembered within a session window
+    static const int SESSION_DUPLICATE_FILTER_SIZE = 64;
+    // Beyond it, the decoders of evicted sessions are freed
+    static const int SPARE_DECODERS_MAX = 256;
+
+    int _decodingWindowSize;
+    uint64_t _idleTimeoutNs;
+    bool _lazyPayloads;
+    bool _inactivation;
+    int _workBudget;
+
+    std::vector< Slot > _slots;
+    int _count;
+
+    std::vector< Session > _pool;
+    std::vector< int > _freeSessions;
+    std::vector< SpareDecoder > _spareDecoders;
+    int _oldest;
+    int _newest;
+
+    std::deque< int > _ready;
+    // Decoded packets of evicted sessions, handed out first
+    std::deque< SessionOutput > _orphans;
+
+    uint64_t _evicted;
+    uint64_t _droppedMalformed;
+
+    StreamStats _stats;
+
+    SessionTable( const SessionTable& ) = delete;
+    SessionTable& operator=( const SessionTable& ) = delete;
+};
@@ -1,16 +1,20 @@
 #pragma once
 
 #include "datablock.h"
+#include "checksum.h"
 
 class SourceBlock : public DataBlock
 {
 public:
-    // From payload
-    SourceBlock( const void* payloadBuffer, int payloadSize );
+    // From payload, optionally stored in a slot of a block arena
+    SourceBlock( const void* payloadBuffer, int payloadSize, BlockArena* arena = nullptr, uint32_t slot = 0 );
 
     // From Raw Buffer
     SourceBlock( int bufferSize, uint8_t* rawBuffer );
 
+    // View on a raw buffer owned by another block (no copy)
+    SourceBlock( std::shared_ptr<void> rawBufferRef, int bufferSize );
+
     virtual ~SourceBlock();
 
     virtual uint16_t payload_size();
@@ -25,12 +29,19 @@ public:
     uint16_t computeCRC();
     bool isCorrectCRC();
 
+    // Raw CRC of the whole buffer, footer included (see checksum.h). Computed once, and
+    // derived from the source CRC without reading the buffer again when possible.
+    uint32_t rawBufferCRC( uint8_t checksumType );
+
 private:
     static const int SOURCEBLOCK_HEADER_SIZE = 6;
     static const int SOURCEBLOCK_GLOBAL_SEQ_IDX_OFFSET = 2;
     static const int SOURCEBLOCK_FOOTER_SIZE = 2;
     void setPayloadSize( uint16_t plSize );
 
+    uint32_t _rawCRC;
+    uint8_t _rawCRCType;
+
 protected:
 
 };
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <cstdint>
+
+// Always-on instrumentation.
+//
+// Writers never take locks: every thread writes to its own shard (picked from
+// a small per-thread index) with relaxed atomics, and readers sum the shards.
+// Reading is therefore safe from any thread, at any time.
+
+static const int STATS_MAX_SHARDS = 8;
+
+// Shard of the calling thread, in [0, STATS_MAX_SHARDS)
+int stats_thread_shard();
+
+inline uint64_t stats_now_ns()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+class StatsCounter
+{
+public:
+    StatsCounter();
+
+    void add( uint64_t n = 1 )
+    {
+        _cells[ stats_thread_shard() ].value.fetch_add( n, std::memory_order_relaxed );
+    }
+
+    uint64_t value() const;
+
+private:
+    // Shards are a cache line apart, to limit false sharing between threads
+    struct Cell
+    {
+        std::atomic< uint64_t > value;
+        char padding[ 64 - sizeof(std::atomic< uint64_t >) ];
+    };
+
+    Cell _cells[ STATS_MAX_SHARDS ];
+};
+
+// Last written value of a quantity owned by a single thread
+class StatsGauge
+{
+public:
+    StatsGauge()
+        :_value(0)
+    {
+    }
+
+    void set( int64_t value )
+    {
+        _value.store( value, std::memory_order_relaxed );
+    }
+
+    int64_t value() const
+    {
+        return _value.load( std::memory_order_relaxed );
+    }
+
+private:
+    std::atomic< int64_t > _value;
+};
+
+struct LatencySummary
+{
+    uint64_t count;
+    uint64_t minNs;
+    uint64_t maxNs;
+    double meanNs;
+    uint64_t p50Ns;
+    uint64_t p90Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+};
+
+// HDR-style histogram of durations in nanoseconds: every power of two is split
+// in 2^SUB_BUCKET_BITS linear buckets, so any recorded value (up to ~18 minutes)
+// is known with a relative error below 1/2^SUB_BUCKET_BITS. Shards are only
+// allocated for threads which record values.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 40;
+    static const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+    virtual ~LatencyHistogram();
+
+    void record( uint64_t ns );
+
+    LatencySummary summary() const;
+    // Number of values in each bucket, summed over all threads
+    std::vector< uint64_t > bucketCounts() const;
+
+    static int bucketIndex( uint64_t v );
+    // Highest value counted in the given bucket
+    static uint64_t bucketUpperBound( int bucket );
+
+private:
+    struct Shard
+    {
+        Shard();
+
+        std::atomic< uint64_t > counts[ BUCKET_COUNT ];
+        std::atomic< uint64_t > total;
+        std::atomic< uint64_t > sum;
+        std::atomic< uint64_t > min;
+        std::atomic< uint64_t > max;
+    };
+
+    Shard* shard();
+
+    std::atomic< Shard* > _shards[ STATS_MAX_SHARDS ];
+
+    LatencyHistogram( const LatencyHistogram& ) = delete;
+    LatencyHistogram& operator=( const LatencyHistogram& ) = delete;
+};
+
+// Per-stream counters, shared by stream encoders and decoders
+struct StreamStats
+{
+    StatsCounter packetsIn;         // Encoder: source packets - Decoder: packets received
+    StatsCounter packetsOut;        // Encoder: packets produced - Decoder: source packets decoded
+    StatsCounter recovered;         // Decoder: source packets rebuilt from repair packets
+    StatsCounter unrecoverable;     // Decoder: source packets which left the window undecoded
+    StatsCounter resyncs;           // Decoder: encoder restarts detected
+    StatsCounter dropped;           // Blocks dropped to stay within the queue limits
+    StatsGauge solverRank;          // Decoder: independent equations in the decoding window
+    StatsGauge windowOccupancy;     // Source packets currently spanned by the window
+    StatsGauge backlog;             // Decoder: solver work items deferred by the work budget
+    StatsCounter expired;           // Decoder: deferred received blocks the window moved past before their turn
+    StatsGauge memoryBytes;         // Bytes of the blocks held by the stream
+};
@@ -7,7 +7,9 @@
 #include "codeblock.h"
 #include "sourceblock.h"
 #include "ogesolver.h"
+#include "queuelimits.h"
 #include "reorderingbuffer.h"
+#include "stats.h"
 
 class Decoder;
 class StreamDecoder
@@ -15,28 +17,83 @@ class StreamDecoder
     friend class Decoder;
 
 public:
-    StreamDecoder( uint16_t decodingWindowSize );
+    // Statistics go to sharedStats if given, shared with other stream decoders
+    // (the sessions of a SessionTable), instead of statistics of its own
+    StreamDecoder( uint16_t decodingWindowSize, StreamStats* sharedStats = nullptr );
     virtual ~StreamDecoder();
 
     void addCodeBlock( uint8_t* buffer, int bufferSize );
-    void addCodeBlock( std::shared_ptr<CodeBlock> cb );
+    // QUEUE_ACCEPTED, QUEUE_DROPPED or QUEUE_REJECTED, see setQueueLimits()
+    int addCodeBlock( std::shared_ptr<CodeBlock> cb );
 
-    bool available();
-    std::shared_ptr< SourceBlock > pop();
+    // True if a block of this epoch and composition would be redundant, see OGESolver::isSolved()
+    bool isSolved( uint32_t epoch, const Composition& compo );
+
+    void setLazyPayloads( bool lazy );
+    void setInactivation( bool inactivation );
+
+    // Caps the solver work done per received block, see OGESolver::setWorkBudget()
+    void setWorkBudget( int budget );
+
+    // Resumes deferred solver work, up to budget row operations (0: all of it).
+    // Returns the number of row operations performed.
+    int run( int budget );
+
+    // Deferred solver work items
+    int backlog();
+
+    // Blocks of the decoding window go to an arena with slots of maxPayloadSize
+    // bytes (0: heap). False if the arena could not be allocated.
+    bool setBlockArena( int maxPayloadSize );
+
+    // Bounds the received blocks waiting for elimination, which only happens
+    // with a work budget. The memory budget only covers the waiting blocks:
+    // the rows of the window are never dropped.
+    void setQueueLimits( const QueueLimits& limits );
+    const QueueLimits& queueLimits();
+
+    // Bytes of the blocks held, see OGESolver::memoryUse()
+    size_t memoryUse();
+
+    const StreamStats& stats();
+
+    // Back to the state of a new stream decoder, keeping its options and allocations
+    void reset();
 
 private:
-    int _curMinSeqIdx;
-    int _curMaxSeqIdx;
-    int _infPacketIdxCount;
+    // Window bounds, in serial number arithmetic (see seq_before())
+    uint32_t _curMinSeqIdx;
+    uint32_t _curMaxSeqIdx;
+    int64_t _firstSeqIdx;       // First index seen since the last reset, -1 if none
+
+    uint32_t _epoch;            // Of the encoder session being decoded
+    uint32_t _previousEpoch;    // Of the session before, whose late blocks are dropped
+    bool _hasPreviousEpoch;
+
+    void resync( uint32_t seqIdx );
+    void anchor( uint32_t seqIdx );
 
     int _decodingWindowSize;
 
     std::shared_ptr<OGESolver> _oge;
-    std::shared_ptr<ReorderingBuffer> _buffer;
+
+    std::unique_ptr<StreamStats> _ownStats;
+    StreamStats* _stats;
 
     Decoder * _parent;
     void setParent( Decoder * parent);
 
+    // Hands the blocks decoded so far to the parent, updating stats
+    void drainOutputs();
+
+    QueueLimits _limits;
+    // Received blocks until the next refresh of the memory use statistic
+    int _memoryStatsCountdown;
+    static const int MEMORY_STATS_PERIOD = 16;
+
+    bool isAccepting();
+    int enforceLimits();
+
 protected:
 
 };
@@ -1,14 +1,22 @@
 #pragma once
 
+#include "blockarena.h"
 #include "codeblock.h"
+#include "queuelimits.h"
 #include "sourceblock.h"
+#include "stats.h"
 
 #include <memory>
 #include <deque>
 #include <random>
+#include <vector>
 
 #include <cstdint>
 
+// Source block selection of random repair blocks
+static const uint8_t SELECTION_UNIFORM = 0;     // Uniformly at random
+static const uint8_t SELECTION_BALANCED = 1;    // Biased toward the blocks least covered so far
+
 class Encoder;
 class StreamEncoder
 {
@@ -19,14 +27,68 @@ public:
     StreamEncoder(int encodingWindowSize = 8, int numSourceBlockPerCodeBlock = 1, int numCodeBlockPerSourceBlock = 1);
     virtual ~StreamEncoder();
 
-    void addData(std::shared_ptr<SourceBlock> cb );
-    void addData( uint8_t* buffer, int bufferSize );
+    // QUEUE_ACCEPTED, QUEUE_DROPPED or QUEUE_REJECTED, see setQueueLimits()
+    int addData(std::shared_ptr<SourceBlock> cb );
+    int addData( uint8_t* buffer, int bufferSize );
 
     void dumpEncodingWindow();
 
+    void setChecksumType( uint8_t type );
+    void setSelectionPolicy( uint8_t policy );
+    // Every random repair block includes the newest source block (Tetrys style)
+    void setIncludeNewest( bool includeNewest );
+    void setStreamId( uint8_t streamId );
+
+    // Source blocks of the window go to an arena with slots of maxPayloadSize
+    // bytes (0: heap). False if the arena could not be allocated.
+    bool setBlockArena( int maxPayloadSize );
+    std::shared_ptr< SourceBlock > createSourceBlock( const void* buffer, int bufferSize );
+
+    // Structured parity instead of random repair blocks: source blocks fill a
+    // matrix of rows x columns, row by row, and each row and each column gets a
+    // parity block (XOR) as soon as it is complete. Columns 0 switches back to
+    // random repair blocks. False if the matrix does not fit in the window.
+    bool setParityMatrix( int columns, int rows );
+
+    // Repair blocks are not built by addData(), which then only queues the
+    // degree 1 block, but by flushRepairs(), or by getEncodedBlock() once the
+    // blocks queued before are fetched. Their compositions are still picked
+    // by addData(), and they are built before a source block leaves the window.
+    void setDeferredRepair( bool deferred );
+    // Builds the pending repair blocks, in one pass over the window. Returns
+    // how many were built, less the blocks then dropped by the queue limits.
+    int flushRepairs();
+    bool hasPendingRepairs();
+
+    // Once no source block came for idleNs (0: never), poll() adds repair
+    // blocks over the tail of the window, whose blocks would otherwise wait
+    // for the next source blocks to be covered.
+    void setTailProtection( uint64_t idleNs );
+    // Returns the number of repair blocks built, at most once per idle period,
+    // less the blocks then dropped by the queue limits
+    int poll( uint64_t nowNs );
+
     bool hasEncodedBlocks();
     std::shared_ptr< CodeBlock > getEncodedBlock();
 
+    // Bounds the encoded blocks waiting for getEncodedBlock(), in number and
+    // in bytes. The source blocks of the window are not counted, as they are
+    // never dropped, nor is the degree 1 block of the newest source block.
+    void setQueueLimits( const QueueLimits& limits );
+    const QueueLimits& queueLimits();
+    // False if the queue is full and new source blocks are refused (DROP_REJECT)
+    bool isAccepting();
+    // Drops the oldest waiting block, or the oldest repair block if repairFirst
+    // and there is one, sparing the newest source block. False if no block
+    // can be dropped.
+    bool dropEncodedBlock( bool repairFirst );
+
+    // Bytes of the source blocks of the window and of the waiting blocks
+    size_t memoryUse();
+    size_t queuedBytes();
+
+    const StreamStats& stats();
+
 private:
     void init();
     void destroy();
@@ -37,8 +99,31 @@ private:
     int _numSourceBlockPerCodeBlock;
     int _numCodeBlockPerSourceBlock;
 
-    std::deque< uint32_t > _encodingWindow;
-    std::deque< std::shared_ptr< SourceBlock > > _sourceBlockBuffer;
+    uint8_t _checksumType;
+    uint8_t _streamId;
+    uint32_t _epoch;                                // Drawn by init(), never 0
+
+    // Encoding window: a ring of parallel arrays (struct of arrays), so that the
+    // per window loops of createEncodedBlocks() scan contiguous memory. Window
+    // position k (0: oldest block) is at ring slot windowSlot( k ).
+    static const int WINDOW_CAPACITY = Composition::MAX_SPAN;
+    struct EncodingWindow
+    {
+        uint32_t seqIdx[ WINDOW_CAPACITY ];
+        int size[ WINDOW_CAPACITY ];                // Source block buffer sizes
+        uint32_t crc[ WINDOW_CAPACITY ];            // Raw buffer CRCs, for _checksumType
+        int coverage[ WINDOW_CAPACITY ];            // Repair blocks including each source block so far
+        const uint8_t* buffer[ WINDOW_CAPACITY ];
+    };
+    EncodingWindow* _window;                        // Cache line aligned
+    std::shared_ptr< SourceBlock > _windowBlocks[ WINDOW_CAPACITY ];
+    int _windowHead;
+    int _windowCount;
+
+    inline int windowSlot( int k ) const
+    {
+        return (_windowHead + k) & (WINDOW_CAPACITY - 1);
+    }
 
     void pushSourceBlock( std::shared_ptr< SourceBlock > cb );
     uint32_t oldestSeqIdx();
@@ -47,11 +132,46 @@ private:
     std::default_random_engine generator;
     std::default_random_engine degree_generator;
 
-    std::shared_ptr< CodeBlock > createEncodedBlock( uint16_t degree );
+    void createEncodedBlocks( int count );
+    void createTailBlocks();
+    void createParityBlocks();
+    void emitRepairBlocks( const std::vector< Composition >& compos );
+    int encodePendingRepairs();
+    void encodeBlocks( const std::vector< Composition >& compos );
     std::shared_ptr< CodeBlock > selectRandomSourceBlock();
     uint16_t pickDegree();
+    int pickSourceBlock( const Composition& compo, std::uniform_int_distribution<int>& distribution );
+
+    uint8_t _selectionPolicy;
+    bool _includeNewest;
+
+    int _parityColumns;                             // 0: random repair blocks
+    int _parityRows;
+    int _parityPosition;                            // Of the next source block in the matrix
+
+    bool _deferredRepair;
+    // Compositions of the repair blocks not built yet, relative to the oldest
+    // block of the window, which cannot change while there are any
+    std::vector< Composition > _pendingRepairs;
+
+    uint64_t _tailIdleNs;                           // 0: no tail protection
+    uint64_t _lastDataNs;
+    bool _tailProtected;                            // Since the last source block
 
     std::deque< std::shared_ptr< CodeBlock > > _codeBlocks;
+    const CodeBlock* _newestSource;                 // Degree 1 block of the newest source block, while waiting
+    size_t _queuedBytes;
+    size_t _windowBytes;
+    QueueLimits _limits;
+
+    void queueEncodedBlock( std::shared_ptr< CodeBlock > cb );
+    bool hasDroppableBlocks();
+    // Drops waiting blocks until the queue is within its limits, returns how many
+    int enforceLimits();
+
+    StreamStats _stats;
+
+    std::shared_ptr< BlockArena > _arena;
 
     Encoder * _parent;
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary trace of what a Decoder ingested, so that a field session can be
+// replayed offline (see the trevi_replay example).
+//
+// File layout: a 8 bytes header ("TRVT", 16-bit version, 16-bit reserved)
+// followed by records. Each record starts with its type (1 byte) and the time
+// elapsed since the previous record in microseconds (varint), then:
+//  - TRACE_RECORD_PACKET: size (varint) and the raw packet bytes, as received
+//  - TRACE_RECORD_STREAM_ADDED: stream id (1 byte), decoding window size (varint)
+//  - TRACE_RECORD_STREAM_REMOVED: stream id (1 byte)
+// Varints are LEB128 (7 bits per byte, least significant group first).
+
+static const uint8_t TRACE_RECORD_PACKET = 0;
+static const uint8_t TRACE_RECORD_STREAM_ADDED = 1;
+static const uint8_t TRACE_RECORD_STREAM_REMOVED = 2;
+
+struct TraceRecord
+{
+    uint8_t type;
+    uint64_t timestampUs;           // Since the start of the recording
+    uint8_t streamId;
+    uint32_t decodingWindowSize;
+    std::vector< uint8_t > data;
+};
+
+class TraceWriter
+{
+public:
+    TraceWriter();
+    virtual ~TraceWriter();
+
+    bool open( const std::string& path );
+    void close();
+    bool isOpen();
+
+    void writePacket( const void* buffer, int bufferSize );
+    void writeStreamAdded( uint8_t streamId, uint32_t decodingWindowSize );
+    void writeStreamRemoved( uint8_t streamId );
+
+private:
+    void writeRecordHeader( uint8_t type );
+    void writeVarint( uint64_t value );
+
+    std::ofstream _ofs;
+    std::chrono::steady_clock::time_point _start;
+    uint64_t _lastTimestampUs;
+    int _recordsSinceFlush;
+};
+
+class TraceReader
+{
+public:
+    TraceReader();
+    virtual ~TraceReader();
+
+    bool open( const std::string& path );
+
+    // Returns false at the end of the trace, or if the trace is truncated
+    bool next( TraceRecord& record );
+
+private:
+    bool readVarint( uint64_t& value );
+
+    std::ifstream _ifs;
+    uint64_t _timestampUs;
+};
@@ -6,6 +6,7 @@
 #include "streamdecoder.h"
 #include "encoder.h"
 #include "decoder.h"
+#include "sessiontable.h"
 
 #include "profiler.h"
 
@@ -26,11 +27,227 @@ typedef struct
     void * streamDecoderRefs[ 32 ];
 } trevi_decoder;
 
+typedef struct
+{
+    void * sessionTableRef;
+} trevi_session_decoder;
+
+typedef struct
+{
+    // Source address of the session packets, as passed to trevi_session_decode()
+    unsigned char address[ 28 ];
+    int address_size;
+    // Session identifier, as passed to trevi_session_decode()
+    unsigned int session_id;
+    // Stream identifier, from the packet headers
+    int stream_id;
+} trevi_session_key;
+
+typedef struct
+{
+    // Packets dropped because their checksum did not match
+    unsigned long long bad_checksum;
+    // Packets dropped because they were truncated or had an inconsistent header
+    unsigned long long malformed;
+    // Packets dropped before decoding because they could not bring anything new:
+    // duplicates of recent packets, or only made of packets already decoded
+    unsigned long long redundant;
+} trevi_decoder_drop_counters;
+
+///
+/// Per-stream options, see trevi_encoder_set_stream_option() and trevi_decoder_set_stream_option()
+typedef enum
+{
+    /// Decoder: eliminate on coefficients only, and XOR payloads only for packets that actually get recovered (0: off - default, 1: on)
+    /// Saves a lot of CPU under heavy loss, when many coded packets leave the decoding window before being useful
+    TREVI_DECODER_LAZY_PAYLOADS = 0,
+
+    /// Encoder: checksum protecting the encoded packets, one of trevi_checksum_type (default: TREVI_CHECKSUM_CRC16)
+    /// The checksum type is signaled in each packet, so the decoder does not need to be configured
+    TREVI_ENCODER_CHECKSUM = 1,
+
+    /// Encoder: keep the packets of the encoding window in one huge page backed region, in slots
+    /// fitting packets of up to value bytes (0: off - default). Larger packets still go to the heap
+    /// Cuts TLB misses with many streams or wide windows
+    TREVI_ENCODER_BLOCK_ARENA = 2,
+
+    /// Decoder: same as TREVI_ENCODER_BLOCK_ARENA, for the packets held by the decoding window
+    TREVI_DECODER_BLOCK_ARENA = 3,
+
+    /// Decoder: maximum number of solver row operations per packet passed to trevi_decode() (0: no limit - default)
+    /// Bounds the worst-case time of trevi_decode(): the remaining work is deferred, and resumed by the next
+    /// packets or by trevi_decoder_run(). Packets decoded by deferred work are only available once it is done
+    TREVI_DECODER_WORK_BUDGET = 4,
+
+    /// Decoder: also recover the packets which only the whole set of received equations determines, with
+    /// inactivation decoding of the rows left undetermined (0: off - default, 1: on)
+    /// Recovers more under heavy loss with wide decoding windows, for a cost growing with the undetermined rows
+    /// This work cannot be split: with TREVI_DECODER_WORK_BUDGET, it is left to trevi_decoder_run() with no budget
+    TREVI_DECODER_INACTIVATION = 5,
+
+    /// Encoder: how random coded packets pick their source packets, one of trevi_selection_policy (default: TREVI_SELECTION_UNIFORM)
+    TREVI_ENCODER_SELECTION = 6,
+
+    /// Encoder: every random coded packet includes the newest source packet (0: off - default, 1: on)
+    /// Cuts the recovery delay of the latest losses, as in Tetrys
+    TREVI_ENCODER_INCLUDE_NEWEST = 7,
+
+    /// Encoder: maximum number of encoded packets waiting for trevi_encoder_get_encoded_data() (0: no limit - default)
+    /// Decoder: maximum number of received packets waiting for the work deferred by TREVI_DECODER_WORK_BUDGET (0: no limit - default)
+    /// Over the limit, TREVI_STREAM_DROP_POLICY applies
+    TREVI_STREAM_QUEUE_CAPACITY = 8,
+
+    /// Encoder and decoder: memory budget of the waiting packets of TREVI_STREAM_QUEUE_CAPACITY, in bytes (0: no limit - default)
+    /// The packets of the encoding or decoding window are never dropped, and not counted: the memory_bytes field of the
+    /// stream statistics reports both. The encoder never drops the newest source packet
+    TREVI_STREAM_MEMORY_BUDGET = 9,
+
+    /// Encoder and decoder: what to do over the stream limits, one of trevi_drop_policy (default: TREVI_DROP_OLDEST_REPAIR)
+    TREVI_STREAM_DROP_POLICY = 10,
+
+    /// Encoder: trevi_encode() only queues the source packet, whose latency is then a single copy, and repair packets
+    /// are built by trevi_encoder_flush_repair(), or by trevi_encoder_get_encoded_data() once the packets queued before
+    /// are fetched (0: off - default, 1: on)
+    TREVI_ENCODER_DEFERRED_REPAIR = 11,
+
+    /// Encoder: once no packet was encoded for this time, in milliseconds, trevi_encoder_poll() adds repair packets over
+    /// the newest source packets, which would otherwise wait for the next packets to be protected (0: off - default)
+    /// Bounds the recovery delay of the end of a talkspurt or a video frame. See also trevi_decoder_set_hold_timeout()
+    TREVI_ENCODER_TAIL_PROTECTION = 12
+} trevi_stream_option;
+
+typedef enum
+{
+    /// Drop the oldest waiting repair packets first, then the oldest waiting packets
+    TREVI_DROP_OLDEST_REPAIR = 0,
+    /// Drop the oldest waiting packets
+    TREVI_DROP_OLDEST = 1,
+    /// Drop nothing: trevi_encode() or trevi_decode() refuse new packets with TREVI_BACKPRESSURE
+    /// until the waiting packets are retrieved, or processed by trevi_decoder_run()
+    TREVI_DROP_REJECT = 2
+} trevi_drop_policy;
+
+///
+/// Return codes of trevi_encode() and trevi_decode()
+typedef enum
+{
+    TREVI_OK = 0,
+    TREVI_ERROR = -1,
+    /// The packet was refused, a queue being full (TREVI_DROP_REJECT): nothing was done, try again once it is drained
+    TREVI_BACKPRESSURE = -2,
+    /// The packet was processed, and older packets were dropped to stay within the queue limits
+    TREVI_DROPPED = 1
+} trevi_status;
+
+typedef enum
+{
+    /// Source packets picked uniformly at random in the encoding window
+    TREVI_SELECTION_UNIFORM = 0,
+    /// Biased toward the source packets covered by the fewest coded packets so far, which would
+    /// otherwise be the first ones to be left unrecovered
+    TREVI_SELECTION_BALANCED = 1
+} trevi_selection_policy;
+
+typedef enum
+{
+    /// CRC-16/XMODEM
+    TREVI_CHECKSUM_CRC16 = 0,
+    /// CRC-32C (Castagnoli), stronger, and hardware accelerated on SSE4.2/PCLMUL capable CPUs
+    TREVI_CHECKSUM_CRC32C = 1
+} trevi_checksum_type;
+
+typedef struct
+{
+    // Pointer to the decoded payload, owned by the decoder
+    const void * data;
+    // Size of the decoded payload (in bytes)
+    int size;
+    // Sequence number of the decoded packet
+    unsigned int seq_idx;
+    // Internal reference keeping data alive until trevi_decoder_release_view() is called
+    void * ref;
+} trevi_decoded_view;
+
+typedef struct
+{
+    // Number of recorded values
+    unsigned long long count;
+    unsigned long long min_ns;
+    unsigned long long max_ns;
+    double mean_ns;
+    // Percentiles, with a relative error below 1/16
+    unsigned long long p50_ns;
+    unsigned long long p90_ns;
+    unsigned long long p99_ns;
+    unsigned long long p999_ns;
+} trevi_latency_stats;
+
+typedef struct
+{
+    int stream_id;
+    // Encoder: source packets passed to trevi_encode() - Decoder: packets received for this stream
+    unsigned long long packets_in;
+    // Encoder: encoded packets produced - Decoder: source packets decoded
+    unsigned long long packets_out;
+    // Decoder only: source packets rebuilt from repair packets
+    unsigned long long recovered;
+    // Decoder only: source packets which left the decoding window without being decoded
+    unsigned long long unrecoverable;
+    // Decoder only: encoder restarts detected, each one resetting the decoding window at once
+    unsigned long long resyncs;
+    // Decoder only: number of independent equations held in the decoding window
+    int solver_rank;
+    // Number of source packets currently spanned by the encoding or decoding window
+    int window_occupancy;
+    // Decoder only: solver work items deferred by TREVI_DECODER_WORK_BUDGET, see trevi_decoder_run()
+    int backlog;
+    // Decoder only: deferred packets the decoding window moved past before they could be processed
+    unsigned long long expired;
+    // Waiting packets dropped to stay within the limits of the stream
+    unsigned long long dropped;
+    // Bytes of the packets held by the stream (decoders refresh it every 16 packets)
+    long long memory_bytes;
+} trevi_stream_stats;
+
+typedef struct
+{
+    int num_streams;
+    trevi_stream_stats streams[ 32 ];
+    // Bytes of the packets held by all streams
+    long long memory_bytes;
+    // Time spent in trevi_encode()
+    trevi_latency_stats encode_latency;
+} trevi_encoder_stats;
+
+typedef struct
+{
+    int num_streams;
+    trevi_stream_stats streams[ 32 ];
+    // Packets rejected by the integrity checks, see trevi_decoder_get_drop_counters()
+    trevi_decoder_drop_counters drops;
+    // Decoded packets dropped to stay within the output limits, see trevi_decoder_set_output_limits()
+    unsigned long long dropped_outputs;
+    // Bytes of the packets held by all streams, and of the decoded packets not retrieved yet
+    long long memory_bytes;
+    // Time spent in trevi_decode()
+    trevi_latency_stats decode_latency;
+    // Time between the decoding of a packet and its retrieval by the application
+    trevi_latency_stats reordering_delay;
+} trevi_decoder_stats;
+
 ///
 /// \brief trevi_init
 /// Initialize Trevi.
 void trevi_init();
 
+///
+/// \brief trevi_get_simd_path
+/// Name of the SIMD code path of payload operations. trevi_init() selects the
+/// fastest one supported by the host ("portable", "neon", "ssse3", "avx2",
+/// "avx2-gfni", "avx512" or "avx512-gfni").
+/// \return the code path name
+const char * trevi_get_simd_path();
+
 ///
 /// \brief trevi_create_encoder
 /// \return a pointer to a trevi_encoder struct
@@ -58,16 +275,68 @@ int trevi_encoder_add_stream( trevi_encoder* encoder, int streamId, int encoding
 ///
 int trevi_encoder_remove_stream( trevi_encoder* encoder, int streamId );
 
+///
+/// \brief trevi_encoder_set_stream_option Change an option of an encoding stream
+/// \param encoder Pointer to the encoder
+/// \param streamId Identifier of the stream
+/// \param option Option to change
+/// \param value New value of the option
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_encoder_set_stream_option( trevi_encoder* encoder, int streamId, trevi_stream_option option, int value );
+
+///
+/// \brief trevi_encoder_set_stream_parity Switch a stream to structured row/column parity (SMPTE 2022-1 style)
+/// Source packets fill a matrix of rows x columns, row by row. A row parity packet (XOR of the row) follows
+/// each complete row, and the column parity packets follow the last row of the matrix. Column parity
+/// recovers bursts of up to columns consecutive packets, for a fixed cost of one XOR per source packet and parity packet.
+/// Replaces the random repair packets of the stream, and the decoding window must be larger than the matrix.
+/// \param encoder Pointer to the encoder
+/// \param streamId Identifier of the stream
+/// \param columns Number of columns L, or 0 to switch back to random repair packets (1: no row parity)
+/// \param rows Number of rows D (1: no column parity)
+/// \return 0 if succesful, -1 if the matrix has more than 32 packets
+///
+int trevi_encoder_set_stream_parity( trevi_encoder* encoder, int streamId, int columns, int rows );
+
 ///
 /// \brief trevi_encode Encode a new packet
 /// \param encoder Pointer to the encoder
 /// \param streamId Identifier of the stream that should process this packet
 /// \param buffer Pointer to the data that will be processed
 /// \param bufferSize Size of the data buffer
-/// \return 0 if succesful, negative error code otherwise
+/// \return TREVI_OK if succesful, TREVI_DROPPED if waiting packets were dropped to stay within the limits,
+/// TREVI_BACKPRESSURE if the packet was refused, see trevi_drop_policy, negative error code otherwise
 ///
 int trevi_encode( trevi_encoder* encoder, int streamId, const void* buffer, int bufferSize );
 
+///
+/// \brief trevi_encoder_set_queue_limits Bound the encoded packets waiting over all streams of an encoder
+/// Applies on top of the limits of each stream (see TREVI_STREAM_QUEUE_CAPACITY): packets are dropped from the stream holding the most
+/// \param encoder Pointer to the encoder
+/// \param capacity Maximum number of waiting packets (0: no limit)
+/// \param memoryBudget Maximum number of bytes of the waiting packets of all streams, windows excluded (0: no limit)
+/// \param policy What to do over the limits
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_encoder_set_queue_limits( trevi_encoder* encoder, int capacity, long long memoryBudget, trevi_drop_policy policy );
+
+///
+/// \brief trevi_encoder_flush_repair Build the repair packets deferred by TREVI_ENCODER_DEFERRED_REPAIR
+/// Can be called when the sender has time to spare, e.g. right after sending the source packets
+/// \param encoder Pointer to the encoder
+/// \return Number of repair packets ready for trevi_encoder_get_encoded_data()
+///
+int trevi_encoder_flush_repair( trevi_encoder* encoder );
+
+///
+/// \brief trevi_encoder_poll Protect the tail of the streams idle for longer than TREVI_ENCODER_TAIL_PROTECTION
+/// To be called periodically, e.g. on a timer of a fraction of the idle time, or whenever the sender wakes up
+/// \param encoder Pointer to the encoder
+/// \return Number of repair packets ready for trevi_encoder_get_encoded_data()
+///
+int trevi_encoder_poll( trevi_encoder* encoder );
+
 ///
 /// \brief trevi_encoder_get_encoded_data Return encoded data
 /// \param encoder Pointer to the encoder
@@ -92,6 +361,16 @@ trevi_decoder * trevi_create_decoder();
 ///
 int trevi_decoder_add_stream( trevi_decoder* decoder, int streamId, int decodingWindowSize );
 
+///
+/// \brief trevi_decoder_set_stream_option Change an option of a decoding stream
+/// \param decoder Pointer to the decoder
+/// \param streamId Identifier of the stream
+/// \param option Option to change
+/// \param value New value of the option
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_set_stream_option( trevi_decoder* decoder, int streamId, trevi_stream_option option, int value );
+
 ///
 /// \brief trevi_decoder_remove_stream Remove a stream from a decoder
 /// \param decoder Pointer to the decoder
@@ -105,10 +384,50 @@ int trevi_decoder_remove_stream( trevi_decoder* decoder, int streamId );
 /// \param decoder Pointer to the decoder
 /// \param buffer pointer to the encoded data that will be processed
 /// \param bufferSize Size of the data (in bytes) stored in buffer
-/// \return 0 if succesful, negative error code otherwise
+/// \return TREVI_OK if succesful, TREVI_DROPPED if waiting packets were dropped to stay within the limits,
+/// TREVI_BACKPRESSURE if the packet was refused, see trevi_drop_policy, negative error code otherwise
 ///
 int trevi_decode( trevi_decoder* decoder, const void* buffer, int bufferSize );
 
+///
+/// \brief trevi_decoder_set_output_limits Bound the decoded packets held by a decoder until they are retrieved
+/// Over the limits, the oldest decoded packets are dropped, or trevi_decode() refuses new packets (TREVI_DROP_REJECT)
+/// \param decoder Pointer to the decoder
+/// \param capacity Maximum number of decoded packets held (0: no limit)
+/// \param memoryBudget Maximum number of bytes of decoded packets held (0: no limit)
+/// \param policy What to do over the limits (TREVI_DROP_OLDEST_REPAIR is the same as TREVI_DROP_OLDEST here)
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_set_output_limits( trevi_decoder* decoder, int capacity, long long memoryBudget, trevi_drop_policy policy );
+
+///
+/// \brief trevi_decoder_set_hold_timeout Bound the time decoded packets are held for reordering
+/// Without it, decoded packets are only released once 64 more are decoded, which may not happen for a while at the end of
+/// a burst. With it, packets in order are released at once, and the others after holdTimeoutMs at most: the missing
+/// packets before them are given up on, and are returned out of order if they are recovered later
+/// \param decoder Pointer to the decoder
+/// \param holdTimeoutMs Maximum time a decoded packet is held, in milliseconds (0: no timeout - default)
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_set_hold_timeout( trevi_decoder* decoder, int holdTimeoutMs );
+
+///
+/// \brief trevi_decoder_poll Release the decoded packets held for longer than the hold timeout
+/// trevi_decode() does it as well: to be called periodically when no packet arrives
+/// \param decoder Pointer to the decoder
+/// \return Number of packets released for trevi_decoder_get_decoded_data()
+///
+int trevi_decoder_poll( trevi_decoder* decoder );
+
+///
+/// \brief trevi_decoder_run Resume the decoding work deferred by TREVI_DECODER_WORK_BUDGET
+/// Call it when idle, e.g. between bursts of packets, so that the backlog does not build up
+/// \param decoder Pointer to the decoder
+/// \param budget Maximum number of solver row operations to perform, over all streams (0: no limit)
+/// \return The number of deferred work items left, -1 on error
+///
+int trevi_decoder_run( trevi_decoder* decoder, int budget );
+
 ///
 /// \brief trevi_decoder_get_decoded_data Retrieve decoded data from the decoder
 /// \param decoder Pointer to the decoder
@@ -117,3 +436,134 @@ int trevi_decode( trevi_decoder* decoder, const void* buffer, int bufferSize );
 /// \return Number of bytes written to out_buffer
 ///
 int trevi_decoder_get_decoded_data( trevi_decoder* decoder, void* out_buffer, unsigned int* packetSeqIdx );
+
+///
+/// \brief trevi_decoder_get_drop_counters Retrieve the number of incoming packets rejected by the decoder
+/// Every packet is verified once when it enters the decoder, and dropped if it is corrupted
+/// Useless packets are dropped even before that, from their header only
+/// \param decoder Pointer to the decoder
+/// \param counters Pointer to the counters that will be filled
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_get_drop_counters( trevi_decoder* decoder, trevi_decoder_drop_counters* counters );
+
+///
+/// \brief trevi_decoder_get_decoded_view Retrieve decoded data from the decoder without copying it
+/// The view points directly into the decoder buffers, and stays valid until it is released with trevi_decoder_release_view()
+/// \param decoder Pointer to the decoder
+/// \param view Pointer to the view that will be filled with the decoded packet information
+/// \return -1 if no decoded data is available, size of the decoded payload otherwise
+///
+int trevi_decoder_get_decoded_view( trevi_decoder* decoder, trevi_decoded_view* view );
+
+///
+/// \brief trevi_decoder_release_view Release a view previously returned by trevi_decoder_get_decoded_view()
+/// \param decoder Pointer to the decoder
+/// \param view Pointer to the view to release. Its data pointer must not be used afterwards.
+///
+void trevi_decoder_release_view( trevi_decoder* decoder, trevi_decoded_view* view );
+
+///
+/// \brief trevi_decoder_start_recording Record every packet passed to trevi_decode(), with its arrival time, to a binary trace file
+/// The trace also holds the declared streams, and can be replayed offline with the trevi_replay example application
+/// \param decoder Pointer to the decoder
+/// \param path Path of the trace file, overwritten if it exists
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_start_recording( trevi_decoder* decoder, const char* path );
+
+///
+/// \brief trevi_decoder_stop_recording Stop recording and close the trace file
+/// \param decoder Pointer to the decoder
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_stop_recording( trevi_decoder* decoder );
+
+///
+/// \brief trevi_encoder_get_stats Retrieve the counters and latency statistics of an encoder
+/// Statistics are always collected, at a very low cost, and can be read from any thread while the encoder is running,
+/// as long as streams are not added or removed concurrently
+/// \param encoder Pointer to the encoder
+/// \param stats Pointer to the statistics that will be filled
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_encoder_get_stats( trevi_encoder* encoder, trevi_encoder_stats* stats );
+
+///
+/// \brief trevi_decoder_get_stats Retrieve the counters and latency statistics of a decoder
+/// Statistics are always collected, at a very low cost, and can be read from any thread while the decoder is running,
+/// as long as streams are not added or removed concurrently
+/// \param decoder Pointer to the decoder
+/// \param stats Pointer to the statistics that will be filled
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_decoder_get_stats( trevi_decoder* decoder, trevi_decoder_stats* stats );
+
+///
+/// \brief trevi_create_session_decoder Create a decoder serving any number of senders
+/// Packets are demultiplexed by (source address, session ID, stream ID), each session being decoded on its own,
+/// as if by a trevi_decoder with a single stream. Sessions are created by their first packet, and evicted
+/// once idle for idleTimeoutMs: the packets they did not decode by then are lost.
+/// \param decodingWindowSize Decoding window size of every session
+/// \param idleTimeoutMs Time without packets after which a session is evicted, in milliseconds (strictly positive)
+/// \return A pointer to a newly created trevi_session_decoder, nullptr if the parameters are invalid
+///
+trevi_session_decoder * trevi_create_session_decoder( int decodingWindowSize, int idleTimeoutMs );
+
+///
+/// \brief trevi_session_decoder_set_option Change an option of the sessions created from now on
+/// \param decoder Pointer to the session decoder
+/// \param option Decoder option to change (TREVI_DECODER_LAZY_PAYLOADS, TREVI_DECODER_WORK_BUDGET or TREVI_DECODER_INACTIVATION)
+/// \param value New value of the option
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_session_decoder_set_option( trevi_session_decoder* decoder, trevi_stream_option option, int value );
+
+///
+/// \brief trevi_session_decode Process a coded packet, in the session it belongs to
+/// Also evicts the sessions idle for too long
+/// \param decoder Pointer to the session decoder
+/// \param address Source address of the packet (e.g. the sockaddr filled by recvfrom()), compared byte by byte
+/// \param addressSize Size of the address, up to 28 bytes
+/// \param sessionId Session identifier, for senders sharing an address (0 if unused)
+/// \param buffer Pointer to the encoded data that will be processed
+/// \param bufferSize Size of the data (in bytes) stored in buffer
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_session_decode( trevi_session_decoder* decoder, const void* address, int addressSize, unsigned int sessionId, const void* buffer, int bufferSize );
+
+///
+/// \brief trevi_session_decoder_get_decoded_data Retrieve decoded data from any session
+/// Sessions with decoded data are served in turn, one packet each
+/// \param decoder Pointer to the session decoder
+/// \param out_buffer Buffer of bytes to which decoded data will be written
+/// \param packetSeqIdx Pointer to an unsigned int, value will be modified to contain the sequence number of the packet in its session
+/// \param key Pointer to the session key that will be filled, may be nullptr
+/// \return -1 if no decoded data is available, number of bytes written to out_buffer otherwise
+///
+int trevi_session_decoder_get_decoded_data( trevi_session_decoder* decoder, void* out_buffer, unsigned int* packetSeqIdx, trevi_session_key* key );
+
+///
+/// \brief trevi_session_decoder_evict_idle Evict the sessions idle for too long
+/// trevi_session_decode() does it already: call it when no packets are received for a while
+/// \param decoder Pointer to the session decoder
+/// \return The number of sessions evicted, -1 on error
+///
+int trevi_session_decoder_evict_idle( trevi_session_decoder* decoder );
+
+///
+/// \brief trevi_session_decoder_get_session_count Number of sessions currently held
+/// \param decoder Pointer to the session decoder
+/// \return The number of sessions, -1 on error
+///
+int trevi_session_decoder_get_session_count( trevi_session_decoder* decoder );
+
+///
+/// \brief trevi_session_decoder_get_stats Retrieve the statistics of the sessions, taken together
+/// Counters are summed over every session, gauges are the values of the session updated last.
+/// Latencies are not recorded for sessions.
+/// \param decoder Pointer to the session decoder
+/// \param stats Pointer to the statistics that will be filled, stream_id being -1
+/// \return 0 if succesful, negative error code otherwise
+///
+int trevi_session_decoder_get_stats( trevi_session_decoder* decoder, trevi_stream_stats* stats );
@@ -8,13 +8,10 @@
 #include <algorithm>
 
 #include "profiler.h"
+#include "wire.h"
 
 bool isBigEndian();
 bool isLittleEndian();
-void write16ToBuffer( void* ptr, uint16_t value );
-uint16_t read16FromBuffer( void * ptr );
-void write32ToBuffer( void * ptr, uint32_t value );
-uint32_t read32FromBuffer( void* ptr );
 void print_bytes(std::ostream& out, const char *title, const unsigned char *data, size_t dataLen, bool format = true, int symbol_per_line = 64 );
 void printSet( std::set<uint32_t> myset );
 
@@ -31,9 +28,7 @@ void printVector(const std::vector< T >& v )
 template< class T >
 void removeDups( std::vector< T >& vec )
 {
-#ifdef USE_PROFILING
-    $
-#endif
+    TREVI_TRACE_SCOPE();
     std::sort( vec.begin(), vec.end() );
     vec.erase( unique( vec.begin(), vec.end() ), vec.end() );
 }
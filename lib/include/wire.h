@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Wire format accessors.
+//
+// Multi-byte fields have a fixed byte order on the wire, whatever the host:
+// 16-bit fields are little-endian and 32-bit fields are big-endian, which is
+// what the original htons()/htonl() based helpers produced on x86 hosts.
+//
+// Loads and stores go through memcpy (no alignment requirement, no aliasing
+// issue) and byte swaps through compiler builtins, so that each accessor
+// inlines to a single load or store (movbe when available).
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define TREVI_BIG_ENDIAN_HOST
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+inline constexpr uint16_t wire_bswap16( uint16_t v ) { return __builtin_bswap16( v ); }
+inline constexpr uint32_t wire_bswap32( uint32_t v ) { return __builtin_bswap32( v ); }
+#else
+inline constexpr uint16_t wire_bswap16( uint16_t v ) { return (uint16_t)((v >> 8) | (v << 8)); }
+inline constexpr uint32_t wire_bswap32( uint32_t v )
+{
+    return (v >> 24) | ((v >> 8) & 0x0000FF00) | ((v << 8) & 0x00FF0000) | (v << 24);
+}
+#endif
+
+// Host <-> wire conversions
+#ifdef TREVI_BIG_ENDIAN_HOST
+inline constexpr uint16_t wire_le16( uint16_t v ) { return wire_bswap16( v ); }
+inline constexpr uint32_t wire_be32( uint32_t v ) { return v; }
+#else
+inline constexpr uint16_t wire_le16( uint16_t v ) { return v; }
+inline constexpr uint32_t wire_be32( uint32_t v ) { return wire_bswap32( v ); }
+#endif
+
+inline void write16ToBuffer( void* ptr, uint16_t value )
+{
+    uint16_t v = wire_le16( value );
+    memcpy( ptr, &v, sizeof(v) );
+}
+
+inline uint16_t read16FromBuffer( const void* ptr )
+{
+    uint16_t v;
+    memcpy( &v, ptr, sizeof(v) );
+    return wire_le16( v );
+}
+
+inline void write32ToBuffer( void* ptr, uint32_t value )
+{
+    uint32_t v = wire_be32( value );
+    memcpy( ptr, &v, sizeof(v) );
+}
+
+inline uint32_t read32FromBuffer( const void* ptr )
+{
+    uint32_t v;
+    memcpy( &v, ptr, sizeof(v) );
+    return wire_be32( v );
+}
@@ -0,0 +1,104 @@
+#include "blockarena.h"
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+std::shared_ptr<BlockArena> BlockArena::create(int maxPayloadSize, int slotCount)
+{
+    std::shared_ptr< BlockArena > ret( new BlockArena( maxPayloadSize, slotCount ) );
+    if( ret->_base == nullptr )
+    {
+        return nullptr;
+    }
+    return ret;
+}
+
+BlockArena::BlockArena(int maxPayloadSize, int slotCount)
+    :_base(nullptr), _regionSize(0), _mapped(false), _hugePages(false), _slotCount(slotCount)
+{
+    // Cache line aligned slots, in a region rounded up to whole huge pages
+    _slotSize = (maxPayloadSize + BLOCK_ARENA_SLOT_OVERHEAD + 63) & ~63;
+    _regionSize = ((size_t)_slotSize * _slotCount + BLOCK_ARENA_HUGE_PAGE_SIZE - 1) & ~(BLOCK_ARENA_HUGE_PAGE_SIZE - 1);
+
+    _busy.reset( new std::atomic< bool >[ _slotCount ] );
+    for( int i = 0; i < _slotCount; ++i )
+    {
+        _busy[i].store( false, std::memory_order_relaxed );
+    }
+
+#ifdef __linux__
+    void* p = mmap( nullptr, _regionSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+    if( p != MAP_FAILED )
+    {
+        _hugePages = true;
+    }
+    else
+    {
+        p = mmap( nullptr, _regionSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+#ifdef MADV_HUGEPAGE
+        if( p != MAP_FAILED )
+        {
+            _hugePages = madvise( p, _regionSize, MADV_HUGEPAGE ) == 0;
+        }
+#endif
+    }
+    if( p != MAP_FAILED )
+    {
+        _base = (uint8_t*)p;
+        _mapped = true;
+        return;
+    }
+#endif
+
+    _base = (uint8_t*)malloc( _regionSize );
+}
+
+BlockArena::~BlockArena()
+{
+#ifdef __linux__
+    if( _mapped )
+    {
+        munmap( _base, _regionSize );
+        return;
+    }
+#endif
+    free( _base );
+}
+
+std::shared_ptr<void> BlockArena::acquire(uint32_t index, int bufferSize)
+{
+    int slot = (int)(index % (uint32_t)_slotCount);
+    if( bufferSize > _slotSize || _busy[ slot ].exchange( true, std::memory_order_acquire ) )
+    {
+        return nullptr;
+    }
+
+    // The deleter keeps the arena alive until the last block using it is gone
+    std::shared_ptr< BlockArena > self = shared_from_this();
+    return std::shared_ptr< void >( _base + (size_t)slot * _slotSize, [self, slot]( void* ) { self->release( slot ); } );
+}
+
+int BlockArena::slotSize() const
+{
+    return _slotSize;
+}
+
+int BlockArena::slotCount() const
+{
+    return _slotCount;
+}
+
+bool BlockArena::hugePages() const
+{
+    return _hugePages;
+}
+
+void BlockArena::release(int slot)
+{
+    _busy[ slot ].store( false, std::memory_order_release );
+}
@@ -0,0 +1,51 @@
+
+#include "checksum.h"
+#include "crc16.h"
+#include "crc32c.h"
+
+uint32_t checksum_raw(uint8_t type, const void *buffer, int size)
+{
+    if( type == CHECKSUM_CRC32C )
+    {
+        // crc32c() inverts the register before and after processing
+        return ~crc32c( 0xFFFFFFFF, buffer, size );
+    }
+    return crc16( (const char*)buffer, size );
+}
+
+uint32_t checksum_concat(uint8_t type, uint32_t rawA, uint32_t rawB, int sizeB)
+{
+    return checksum_pad( type, rawA, sizeB ) ^ rawB;
+}
+
+uint32_t checksum_pad(uint8_t type, uint32_t raw, int padSize)
+{
+    if( padSize <= 0 )
+    {
+        return raw;
+    }
+    if( type == CHECKSUM_CRC32C )
+    {
+        return crc32c_shift( raw, padSize );
+    }
+    return crc16_shift( (uint16_t)raw, padSize );
+}
+
+uint32_t checksum_final(uint8_t type, uint32_t raw, int size)
+{
+    if( type == CHECKSUM_CRC32C )
+    {
+        // Account for the all-ones initial register, then for the final inversion
+        return ~( crc32c_shift( 0xFFFFFFFF, size ) ^ raw );
+    }
+    return raw;
+}
+
+uint32_t checksum_compute(uint8_t type, const void *buffer, int size)
+{
+    if( type == CHECKSUM_CRC32C )
+    {
+        return crc32c( 0, buffer, size );
+    }
+    return crc16( (const char*)buffer, size );
+}
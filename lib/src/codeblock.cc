@@ -1,12 +1,9 @@
 #include "codeblock.h"
-#include "crc16.h"
 #include "gf256.h"
 
 #include <cstring>
 
 #include <iostream>
-#include <bitset>
-#include <sstream>
 
 using namespace std;
 
@@ -15,18 +12,48 @@ CodeBlock::CodeBlock(uint16_t mtu, const void * payloadBuffer, int payloadSize)
 {
     initMemory( CODEBLOCK_HEADER_SIZE + mtu + CODEBLOCK_FOOTER_SIZE );
 
+    memset( buffer_ptr(), 0, CODEBLOCK_HEADER_SIZE );
     memcpy( payload_ptr(), payloadBuffer, payloadSize );
     setPayloadSize( payloadSize );
     setMNS();
     setMNE();
 }
 
-CodeBlock::CodeBlock(const void * rawBuffer, int rawBufferSize)
+CodeBlock::CodeBlock(int payloadSize, BlockArena *arena, uint32_t slot)
 {
-    initMemory( rawBufferSize );
+    initMemory( CODEBLOCK_HEADER_SIZE + payloadSize + CODEBLOCK_FOOTER_SIZE, arena, slot );
+
+    memset( buffer_ptr(), 0, CODEBLOCK_HEADER_SIZE + payloadSize );
+    setPayloadSize( payloadSize );
+    setMNS();
+    setMNE();
+}
+
+CodeBlock::CodeBlock(const void * rawBuffer, int rawBufferSize, BlockArena *arena, uint32_t slot)
+{
+    initMemory( rawBufferSize, arena, slot );
     memcpy( buffer_ptr(), rawBuffer, rawBufferSize );
 }
 
+CodeBlock::CodeBlock(const std::vector<std::shared_ptr<CodeBlock> > &blocks)
+{
+    int plSize = 0;
+    for( auto b : blocks )
+    {
+        plSize = max( plSize, (int)b->payload_size() );
+    }
+
+    initMemory( CODEBLOCK_HEADER_SIZE + plSize + CODEBLOCK_FOOTER_SIZE );
+    memset( buffer_ptr(), 0, buffer_size() );
+    for( auto b : blocks )
+    {
+        gf256_add_mem( payload_ptr(), b->payload_ptr(), b->payload_size() );
+    }
+    setPayloadSize( plSize );
+    setMNS();
+    setMNE();
+}
+
 CodeBlock::~CodeBlock()
 {
 
@@ -65,95 +92,146 @@ uint8_t CodeBlock::get_stream_id()
     return ((uint8_t*)buffer_ptr())[ CODEBLOCK_STREAM_ID_OFFSET ];
 }
 
-void CodeBlock::updateCRC()
+void CodeBlock::set_epoch(uint32_t value)
 {
-    uint16_t crcValue = crc16( (const char*)buffer_ptr(), buffer_size() - CODEBLOCK_FOOTER_SIZE );
-    write16ToBuffer( footer_ptr(), crcValue );
+    write32ToBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_EPOCH_OFFSET, value );
 }
 
-uint16_t CodeBlock::readCRC()
+uint32_t CodeBlock::get_epoch()
 {
-    return read16FromBuffer( footer_ptr() );
+    return read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_EPOCH_OFFSET );
 }
 
-bool CodeBlock::isCorrectCRC()
+bool CodeBlock::readHeader(CodeBlockHeader &header)
 {
-    uint16_t rValue = readCRC();
-    uint16_t cValue = crc16( (const char*)buffer_ptr(), buffer_size() - CODEBLOCK_FOOTER_SIZE );
-    return rValue == cValue;
+    return header.read( buffer_ptr(), buffer_size() );
 }
 
-void CodeBlock::setCompositionField(uint32_t offset, std::set<uint32_t> compoSet)
+void CodeBlock::setChecksumType(uint8_t type)
 {
-    std::bitset<32> b(0x00000000);
-    std::set<uint32_t>::iterator it;
-    for (it=compoSet.begin(); it!=compoSet.end(); ++it)
-    {
-        int idx = *it;
-        b.set(idx,1);
-    }
-    uint32_t compoValue = b.to_ulong();
-    write32ToBuffer( ((uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET), compoValue );
-    set_stream_sequence_idx( offset );
+    uint8_t* flagsPtr = (uint8_t*)buffer_ptr() + CODEBLOCK_FLAGS_OFFSET;
+    *flagsPtr = (*flagsPtr & ~CODEBLOCK_FLAGS_CHECKSUM_MASK) | (type & CODEBLOCK_FLAGS_CHECKSUM_MASK);
 }
 
-void CodeBlock::dumpCompositionField()
+uint8_t CodeBlock::checksumType()
 {
-    uint32_t compoValue = read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET );
-    uint32_t offset = get_stream_sequence_idx();
-    std::bitset<32> b(compoValue);
-    for( int i = 0; i < 32; ++i )
+    return ((uint8_t*)buffer_ptr())[ CODEBLOCK_FLAGS_OFFSET ] & CODEBLOCK_FLAGS_CHECKSUM_MASK;
+}
+
+void CodeBlock::updateCRC()
+{
+    if( checksumType() == CHECKSUM_CRC32C )
     {
-        if( b[i] )
-        {
-            cerr << i + offset << " ";
-        }
+        write32ToBuffer( footer_ptr(), computeCRC() );
+    }
+    else
+    {
+        write16ToBuffer( footer_ptr(), (uint16_t)computeCRC() );
+        setMNE();
     }
-    cerr << endl;
 }
 
-string CodeBlock::dumpCompositionFieldStr()
+void CodeBlock::updateCRC(uint32_t rawPayloadCRC)
 {
-    std::stringstream sstr;
-    uint32_t compoValue = read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET );
-    uint32_t offset = get_stream_sequence_idx();
-    std::bitset<32> b(compoValue);
-    for( int i = 0; i < 32; ++i )
+    uint8_t type = checksumType();
+    int payloadAreaSize = buffer_size() - CODEBLOCK_HEADER_SIZE - CODEBLOCK_FOOTER_SIZE;
+    uint32_t rawHeaderCRC = checksum_raw( type, buffer_ptr(), CODEBLOCK_HEADER_SIZE );
+    uint32_t raw = checksum_concat( type, rawHeaderCRC, rawPayloadCRC, payloadAreaSize );
+    uint32_t crcValue = checksum_final( type, raw, CODEBLOCK_HEADER_SIZE + payloadAreaSize );
+    if( type == CHECKSUM_CRC32C )
     {
-        if( b[i] )
-        {
-            sstr << i + offset << " ";
-        }
+        write32ToBuffer( footer_ptr(), crcValue );
+    }
+    else
+    {
+        write16ToBuffer( footer_ptr(), (uint16_t)crcValue );
+        setMNE();
     }
-    return sstr.str();
 }
 
-std::set<uint32_t> CodeBlock::getCompositionSet()
+uint32_t CodeBlock::readCRC()
 {
-    std::set<uint32_t> ret;
-    uint32_t compoValue = read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET );
-    uint32_t offset = get_stream_sequence_idx();
-    std::bitset<32> b(compoValue);
-    for( int i = 0; i < 32; ++i )
+    if( checksumType() == CHECKSUM_CRC32C )
     {
-        if( b[i] )
-        {
-            ret.insert( i + offset );
-        }
+        return read32FromBuffer( footer_ptr() );
     }
-    return ret;
+    return read16FromBuffer( footer_ptr() );
+}
+
+uint32_t CodeBlock::computeCRC()
+{
+    return checksum_compute( checksumType(), buffer_ptr(), buffer_size() - CODEBLOCK_FOOTER_SIZE );
+}
+
+bool CodeBlock::isCorrectCRC()
+{
+    return readCRC() == computeCRC();
+}
+
+bool CodeBlock::isWellFormed()
+{
+    CodeBlockHeader header;
+    if( buffer_size() < CODEBLOCK_HEADER_SIZE + CODEBLOCK_FOOTER_SIZE || !readHeader( header ) )
+        return false;
+    if( header.mns != CODEBLOCK_MNS )
+        return false;
+    if( header.payloadSize > buffer_size() - CODEBLOCK_HEADER_SIZE - CODEBLOCK_FOOTER_SIZE )
+        return false;
+    uint8_t type = header.flags & CODEBLOCK_FLAGS_CHECKSUM_MASK;
+    if( type != CHECKSUM_CRC16 && type != CHECKSUM_CRC32C )
+        return false;
+    return header.composition != 0;
+}
+
+uint64_t CodeBlock::fingerprint(const void *rawBuffer, int rawBufferSize)
+{
+    CodeBlockHeader header;
+    if( rawBufferSize < CODEBLOCK_HEADER_SIZE + CODEBLOCK_FOOTER_SIZE || !header.read( rawBuffer, rawBufferSize ) )
+        return 0;
+    uint32_t footer = read32FromBuffer( (const uint8_t*)rawBuffer + rawBufferSize - CODEBLOCK_FOOTER_SIZE );
+
+    // splitmix64 finalizer over the two halves, the epoch added with a golden ratio multiplier
+    uint64_t h = ((uint64_t)header.seqIdx << 32) | header.composition;
+    h ^= ((uint64_t)footer << 32) | ((uint64_t)header.payloadSize << 16) | ((uint64_t)header.streamId << 8) | header.flags;
+    h += (uint64_t)header.epoch * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h != 0 ? h : 1;
+}
+
+void CodeBlock::setComposition(const Composition &compo)
+{
+    write32ToBuffer( ((uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET), compo.mask() );
+    set_stream_sequence_idx( compo.offset() );
+}
+
+Composition CodeBlock::composition()
+{
+    CodeBlockHeader header;
+    if( !readHeader( header ) )
+        return Composition();
+    return Composition( header.seqIdx, header.composition );
+}
+
+void CodeBlock::dumpCompositionField()
+{
+    cerr << dumpCompositionFieldStr() << endl;
+}
+
+string CodeBlock::dumpCompositionFieldStr()
+{
+    return composition().str();
 }
 
 int CodeBlock::degree()
 {
-    uint32_t compoValue = read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET );
-    std::bitset<32> b(compoValue);
-    return b.count();
+    return composition_popcount( read32FromBuffer( (uint8_t*)buffer_ptr() + CODEBLOCK_COMPO_OFFSET ) );
 }
 
-std::shared_ptr<CodeBlock> CodeBlock::clone()
+std::shared_ptr<CodeBlock> CodeBlock::clone(BlockArena *arena, uint32_t slot)
 {
-    return std::make_shared< CodeBlock >( (uint8_t*)(this->buffer_ptr()), this->buffer_size() );
+    return std::make_shared< CodeBlock >( (uint8_t*)(this->buffer_ptr()), this->buffer_size(), arena, slot );
 }
 
 void CodeBlock::XOR_payload(std::shared_ptr<CodeBlock> other)
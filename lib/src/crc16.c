@@ -79,10 +79,71 @@ static const uint16_t crc16tab[256]= {
     0x6e17,0x7e36,0x4e55,0x5e74,0x2e93,0x3eb2,0x0ed1,0x1ef0
 };
 
-uint16_t crc16(const char *buf, int len) {
-    int counter;
-    uint16_t crc = 0;
-    for (counter = 0; counter < len; counter++)
-            crc = (crc<<8) ^ crc16tab[((crc>>8) ^ *buf++)&0x00FF];
+/* Slice-by-8 tables: crc16tab8[k][b] is the CRC of byte b followed by k zero
+ * bytes, so that 8 input bytes can be folded into the CRC with 8 independent
+ * table lookups instead of 8 dependent ones. Generated by crc16_init(). */
+static uint16_t crc16tab8[8][256];
+static int crc16tab8_initialized = 0;
+
+void crc16_init(void) {
+    int k, b;
+    if (crc16tab8_initialized)
+        return;
+    for (b = 0; b < 256; b++)
+        crc16tab8[0][b] = crc16tab[b];
+    for (k = 1; k < 8; k++)
+        for (b = 0; b < 256; b++)
+            crc16tab8[k][b] = (crc16tab8[k-1][b]<<8) ^ crc16tab[crc16tab8[k-1][b]>>8];
+    crc16tab8_initialized = 1;
+}
+
+uint16_t crc16_update(uint16_t crc, const char *buf, int len) {
+    const unsigned char *p = (const unsigned char *)buf;
+    if (!crc16tab8_initialized)
+        crc16_init();
+    while (len >= 8) {
+        crc = crc16tab8[7][(crc>>8) ^ p[0]] ^ crc16tab8[6][(crc&0xFF) ^ p[1]] ^
+              crc16tab8[5][p[2]] ^ crc16tab8[4][p[3]] ^
+              crc16tab8[3][p[4]] ^ crc16tab8[2][p[5]] ^
+              crc16tab8[1][p[6]] ^ crc16tab8[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = (crc<<8) ^ crc16tab[((crc>>8) ^ *p++)&0x00FF];
+    return crc;
+}
+
+/* Multiplication of two polynomials modulo the CRC polynomial */
+static uint16_t crc16_multmodp(uint16_t a, uint16_t b) {
+    uint16_t p = 0;
+    int bit;
+    for (bit = 15; bit >= 0; bit--) {
+        p = (p & 0x8000) ? (p<<1) ^ 0x1021 : (p<<1);
+        if ((a >> bit) & 1)
+            p ^= b;
+    }
+    return p;
+}
+
+uint16_t crc16_shift(uint16_t crc, int len) {
+    /* x^(8*2^k) mod P, for k = 0..30 */
+    static uint16_t x8pow[31];
+    static int x8pow_initialized = 0;
+    int k;
+    if (!x8pow_initialized) {
+        x8pow[0] = 0x0100; /* x^8 */
+        for (k = 1; k < 31; k++)
+            x8pow[k] = crc16_multmodp(x8pow[k-1], x8pow[k-1]);
+        x8pow_initialized = 1;
+    }
+    for (k = 0; len > 0 && k < 31; k++, len >>= 1) {
+        if (len & 1)
+            crc = crc16_multmodp(x8pow[k], crc);
+    }
     return crc;
 }
+
+uint16_t crc16(const char *buf, int len) {
+    return crc16_update(0, buf, len);
+}
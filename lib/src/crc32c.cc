@@ -0,0 +1,241 @@
+#include "crc32c.h"
+#include "gf256.h"
+
+#include <cstring>
+
+#if defined(GF256_TARGET_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRC32C_TARGET_HW
+#else
+#include <nmmintrin.h> // SSE4.2: _mm_crc32_u64
+#include <wmmintrin.h> // PCLMULQDQ: _mm_clmulepi64_si128
+#define CRC32C_TARGET_HW __attribute__((target("sse4.2,pclmul")))
+#endif
+#endif // GF256_TARGET_X86
+
+// Reflected Castagnoli polynomial
+static const uint32_t CRC32C_POLY = 0x82F63B78;
+
+static uint32_t crc32c_tab[8][256];
+static bool Initialized = false;
+
+//------------------------------------------------------------------------------
+// Polynomial arithmetic modulo the CRC polynomial (reflected representation,
+// bit 31 is x^0). Used to shift CRC registers by a number of zero bytes.
+
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+// Returns x^n mod P
+static uint32_t crc32c_xpow(uint64_t n)
+{
+    uint32_t result = (uint32_t)1 << 31;
+    uint32_t xsq = (uint32_t)1 << 30;
+    while (n)
+    {
+        if (n & 1)
+            result = crc32c_multmodp(xsq, result);
+        xsq = crc32c_multmodp(xsq, xsq);
+        n >>= 1;
+    }
+    return result;
+}
+
+// x^(8*2^k) mod P, for k = 0..30
+static uint32_t crc32c_x8pow[31];
+
+//------------------------------------------------------------------------------
+// Portable slice-by-8 implementation
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, int len)
+{
+    while (len >= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        crc ^= lo;
+        crc = crc32c_tab[7][crc & 0xFF] ^ crc32c_tab[6][(crc >> 8) & 0xFF] ^
+              crc32c_tab[5][(crc >> 16) & 0xFF] ^ crc32c_tab[4][crc >> 24] ^
+              crc32c_tab[3][hi & 0xFF] ^ crc32c_tab[2][(hi >> 8) & 0xFF] ^
+              crc32c_tab[1][(hi >> 16) & 0xFF] ^ crc32c_tab[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = (crc >> 8) ^ crc32c_tab[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+//------------------------------------------------------------------------------
+// SSE4.2 + PCLMULQDQ implementation
+//
+// The crc32 instruction has a latency of 3 cycles but a throughput of 1, so
+// the buffer is processed as 3 independent streams. The CRCs of the first
+// two streams are then shifted over the bytes that follow them (carry-less
+// multiplication by x^(8n-33) mod P, reduced by a last crc32 instruction)
+// and merged into the third one.
+
+#if defined(GF256_TARGET_X86) && (defined(__x86_64__) || defined(_M_X64))
+#define CRC32C_TRY_HW
+
+static bool CpuHasCrc32c = false;
+
+static const int kLongBlock = 1024;
+static const int kShortBlock = 128;
+static uint32_t kLongShift[2];
+static uint32_t kShortShift[2];
+
+static CRC32C_TARGET_HW uint32_t crc32c_hw_shift2(uint32_t crc0, uint32_t k0, uint32_t crc1, uint32_t k1)
+{
+    __m128i a = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc0), _mm_cvtsi32_si128((int)k0), 0x00);
+    __m128i b = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc1), _mm_cvtsi32_si128((int)k1), 0x00);
+    return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(_mm_xor_si128(a, b)));
+}
+
+static CRC32C_TARGET_HW uint32_t crc32c_hw_blocks(uint32_t crc, const uint8_t *&p, int &len, int block, const uint32_t shift[2])
+{
+    while (len >= 3 * block)
+    {
+        uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+        for (int i = 0; i < block; i += 8)
+        {
+            uint64_t v0, v1, v2;
+            memcpy(&v0, p + i, 8);
+            memcpy(&v1, p + block + i, 8);
+            memcpy(&v2, p + 2 * block + i, 8);
+            crc0 = _mm_crc32_u64(crc0, v0);
+            crc1 = _mm_crc32_u64(crc1, v1);
+            crc2 = _mm_crc32_u64(crc2, v2);
+        }
+        crc = crc32c_hw_shift2((uint32_t)crc0, shift[1], (uint32_t)crc1, shift[0]) ^ (uint32_t)crc2;
+        p += 3 * block;
+        len -= 3 * block;
+    }
+    return crc;
+}
+
+static CRC32C_TARGET_HW uint32_t crc32c_hw(uint32_t crc, const uint8_t *p, int len)
+{
+    crc = crc32c_hw_blocks(crc, p, len, kLongBlock, kLongShift);
+    crc = crc32c_hw_blocks(crc, p, len, kShortBlock, kShortShift);
+
+    uint64_t crc64 = crc;
+    while (len >= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (len-- > 0)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif // GF256_TARGET_X86
+
+//------------------------------------------------------------------------------
+// Initialization and dispatch
+
+extern "C" void crc32c_init(void)
+{
+    if (Initialized)
+        return;
+
+    for (int b = 0; b < 256; ++b)
+    {
+        uint32_t crc = (uint32_t)b;
+        for (int k = 0; k < 8; ++k)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        crc32c_tab[0][b] = crc;
+    }
+    for (int k = 1; k < 8; ++k)
+        for (int b = 0; b < 256; ++b)
+            crc32c_tab[k][b] = (crc32c_tab[k - 1][b] >> 8) ^ crc32c_tab[0][crc32c_tab[k - 1][b] & 0xFF];
+
+    crc32c_x8pow[0] = crc32c_xpow(8);
+    for (int k = 1; k < 31; ++k)
+        crc32c_x8pow[k] = crc32c_multmodp(crc32c_x8pow[k - 1], crc32c_x8pow[k - 1]);
+
+#if defined(CRC32C_TRY_HW)
+    unsigned int cpu_info[4];
+    gf256_cpuid(cpu_info, 1);
+    const unsigned int CPUID_ECX_PCLMULQDQ = 0x00000002;
+    const unsigned int CPUID_ECX_SSE42 = 0x00100000;
+    if ((cpu_info[2] & CPUID_ECX_PCLMULQDQ) && (cpu_info[2] & CPUID_ECX_SSE42))
+    {
+        kLongShift[0] = crc32c_xpow(8 * kLongBlock - 33);
+        kLongShift[1] = crc32c_xpow(2 * 8 * kLongBlock - 33);
+        kShortShift[0] = crc32c_xpow(8 * kShortBlock - 33);
+        kShortShift[1] = crc32c_xpow(2 * 8 * kShortBlock - 33);
+
+        // Self-test against the portable implementation before enabling it
+        static uint8_t testBuffer[3 * kLongBlock + 3 * kShortBlock + 13];
+        for (unsigned i = 0; i < sizeof(testBuffer); ++i)
+            testBuffer[i] = (uint8_t)(i * 131 + 7);
+        CpuHasCrc32c = true;
+        for (int len = 0; len <= (int)sizeof(testBuffer); len += 61)
+        {
+            if (crc32c_hw(0xFFFFFFFF, testBuffer, len) != crc32c_sw(0xFFFFFFFF, testBuffer, len))
+                CpuHasCrc32c = false;
+        }
+    }
+#endif
+
+    Initialized = true;
+}
+
+extern "C" uint32_t crc32c(uint32_t crc, const void *buf, int len)
+{
+    if (!Initialized)
+        crc32c_init();
+
+    const uint8_t *p = (const uint8_t *)buf;
+#if defined(CRC32C_TRY_HW)
+    if (CpuHasCrc32c)
+        return ~crc32c_hw(~crc, p, len);
+#endif
+    return ~crc32c_sw(~crc, p, len);
+}
+
+extern "C" int crc32c_hw_enabled(void)
+{
+    if (!Initialized)
+        crc32c_init();
+#if defined(CRC32C_TRY_HW)
+    return CpuHasCrc32c ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+extern "C" uint32_t crc32c_shift(uint32_t crc, int len)
+{
+    if (!Initialized)
+        crc32c_init();
+
+    for (int k = 0; len > 0 && k < 31; ++k, len >>= 1)
+    {
+        if (len & 1)
+            crc = crc32c_multmodp(crc32c_x8pow[k], crc);
+    }
+    return crc;
+}
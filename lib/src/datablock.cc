@@ -1,5 +1,8 @@
 
 #include "datablock.h"
+#include "blockarena.h"
+
+#include <cstdlib>
 
 DataBlock::DataBlock()
 {
@@ -21,9 +24,36 @@ int DataBlock::buffer_size()
     return _bufferSize;
 }
 
+std::shared_ptr<void> DataBlock::payload_ref()
+{
+    // Aliasing constructor: points to the payload, but keeps the whole buffer alive
+    return std::shared_ptr<void>( _data, payload_ptr() );
+}
+
 void DataBlock::initMemory(int bufferSize)
 {
     _bufferSize = bufferSize;
     char* rawPtr = (char*)malloc( _bufferSize );
     _data = std::shared_ptr<void>( (void*)(rawPtr), free );
 }
+
+void DataBlock::initMemory(int bufferSize, BlockArena *arena, uint32_t slot)
+{
+    std::shared_ptr< void > slotMemory;
+    if( arena != nullptr )
+    {
+        slotMemory = arena->acquire( slot, bufferSize );
+    }
+    if( slotMemory == nullptr )
+    {
+        initMemory( bufferSize );
+        return;
+    }
+    shareMemory( slotMemory, bufferSize );
+}
+
+void DataBlock::shareMemory(std::shared_ptr<void> bufferRef, int bufferSize)
+{
+    _bufferSize = bufferSize;
+    _data = bufferRef;
+}
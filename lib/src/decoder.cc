@@ -1,7 +1,11 @@
 
 #include "decoder.h"
 
-Decoder::Decoder()
+#include <algorithm>
+
+Decoder::Decoder(int duplicateFilterSize, bool recordLatency)
+    :_recentFingerprints(duplicateFilterSize, 0), _droppedBadChecksum(0), _droppedMalformed(0), _droppedRedundant(0), _droppedOutputs(0), _holdTimeoutNs(0),
+      _recordLatency(recordLatency)
 {
     _buffer = std::make_shared<ReorderingBuffer>(64);
 }
@@ -15,6 +19,10 @@ void Decoder::addStream(int streamId, StreamDecoder *decoder)
 {
     _decoders.insert( std::make_pair( streamId, decoder ) );
     decoder->setParent( this );
+    if( _recorder )
+    {
+        _recorder->writeStreamAdded( streamId, decoder->_decodingWindowSize );
+    }
     return;
 }
 
@@ -24,30 +32,161 @@ void Decoder::removeStream(int streamId)
     if( kv != _decoders.end() )
     {
         _decoders.erase( kv );
+        if( _recorder )
+        {
+            _recorder->writeStreamRemoved( streamId );
+        }
     }
 }
 
-void Decoder::addCodeBlock(const void* buffer, int bufferSize)
+int Decoder::addCodeBlock(const void* buffer, int bufferSize)
 {
-    std::shared_ptr<CodeBlock> cb = std::make_shared<CodeBlock>( buffer, bufferSize );
-    addCodeBlock( cb );
+    if( !isAccepting() )
+    {
+        return QUEUE_REJECTED;
+    }
+    if( _recorder )
+    {
+        _recorder->writePacket( buffer, bufferSize );
+    }
+    uint64_t start = stats_now_ns();
+    int ret = QUEUE_ACCEPTED;
+    if( bufferSize <= 0 )
+    {
+        _droppedMalformed.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else if( isRedundant( buffer, bufferSize ) )
+    {
+        _droppedRedundant.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else
+    {
+        std::shared_ptr<CodeBlock> cb = std::make_shared<CodeBlock>( buffer, bufferSize );
+        ret = ingest( cb );
+    }
+    if( _recordLatency )
+    {
+        _decodeLatency.record( stats_now_ns() - start );
+    }
+    return ret;
 }
 
-void Decoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
+int Decoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
 {
-    uint8_t streamId = cb->get_stream_id();
-    for( auto kv : _decoders )
+    if( !isAccepting() )
     {
-        if( kv.first == streamId )
-        {
-            kv.second->addCodeBlock( cb );
-        }
+        return QUEUE_REJECTED;
     }
+    if( _recorder )
+    {
+        _recorder->writePacket( cb->buffer_ptr(), cb->buffer_size() );
+    }
+    uint64_t start = stats_now_ns();
+    int ret = QUEUE_ACCEPTED;
+    if( isRedundant( cb->buffer_ptr(), cb->buffer_size() ) )
+    {
+        _droppedRedundant.fetch_add( 1, std::memory_order_relaxed );
+    }
+    else
+    {
+        ret = ingest( cb );
+    }
+    if( _recordLatency )
+    {
+        _decodeLatency.record( stats_now_ns() - start );
+    }
+    return ret;
+}
+
+int Decoder::ingest(std::shared_ptr<CodeBlock> cb)
+{
+    // Verify integrity once, here: a corrupted block would poison the solver
+    if( !cb->isWellFormed() )
+    {
+        _droppedMalformed.fetch_add( 1, std::memory_order_relaxed );
+        return QUEUE_ACCEPTED;
+    }
+    if( !cb->isCorrectCRC() )
+    {
+        _droppedBadChecksum.fetch_add( 1, std::memory_order_relaxed );
+        return QUEUE_ACCEPTED;
+    }
+
+    auto kv = _decoders.find( cb->get_stream_id() );
+    int ret = kv != _decoders.end() ? kv->second->addCodeBlock( cb ) : QUEUE_ACCEPTED;
+    if( ret == QUEUE_REJECTED )
+    {
+        return ret;
+    }
+
+    // Only verified blocks are remembered: a corrupted copy must not shadow a
+    // good one, nor a refused block its retry
+    uint64_t fp = CodeBlock::fingerprint( cb->buffer_ptr(), cb->buffer_size() );
+    _recentFingerprints[ fp & (_recentFingerprints.size() - 1) ] = fp;
+
+    if( _holdTimeoutNs > 0 )
+    {
+        poll( stats_now_ns() );
+    }
+    if( enforceOutputLimits() > 0 )
+    {
+        ret = QUEUE_DROPPED;
+    }
+    return ret;
+}
+
+// Blocks which cannot bring anything new are dropped before any allocation or
+// payload access: exact duplicates of recently accepted blocks (multipath,
+// retransmissions), and blocks only made of source blocks already decoded.
+// Only header fields are read, the integrity checks come later.
+bool Decoder::isRedundant(const void *buffer, int bufferSize)
+{
+    uint64_t fp = CodeBlock::fingerprint( buffer, bufferSize );
+    if( fp == 0 )
+    {
+        return false; // Left to the integrity checks
+    }
+    if( _recentFingerprints[ fp & (_recentFingerprints.size() - 1) ] == fp )
+    {
+        return true;
+    }
+
+    CodeBlockHeader header;
+    header.read( buffer, bufferSize );
+    auto kv = _decoders.find( header.streamId );
+    return kv != _decoders.end() && kv->second->isSolved( header.epoch, Composition( header.seqIdx, header.composition ) );
 }
 
 void Decoder::onNewDecodeOutput(const DecodeOutput &deco)
 {
-    _buffer->addBlock( deco.stream_idx, deco.global_idx, deco.block );
+    DecodeOutput stamped = deco;
+    stamped.decode_time_ns = stats_now_ns();
+    _buffer->addBlock( stamped );
+}
+
+void Decoder::onStreamResync()
+{
+    // Blocks of the previous session first, whatever their indices
+    flush();
+}
+
+void Decoder::flush()
+{
+    _buffer->flush();
+}
+
+void Decoder::setHoldTimeout(uint64_t holdNs)
+{
+    _holdTimeoutNs = holdNs;
+}
+
+int Decoder::poll(uint64_t nowNs)
+{
+    if( _holdTimeoutNs == 0 )
+    {
+        return 0;
+    }
+    return _buffer->release( nowNs > _holdTimeoutNs ? nowNs - _holdTimeoutNs : 0 );
 }
 
 bool Decoder::available()
@@ -57,5 +196,140 @@ bool Decoder::available()
 
 std::shared_ptr<SourceBlock> Decoder::pop()
 {
-    return _buffer->pop();
+    DecodeOutput deco;
+    if( !_buffer->pop( deco ) )
+    {
+        return nullptr;
+    }
+    _outputBytes.set( _buffer->bytes() );
+    if( _recordLatency )
+    {
+        _reorderingDelay.record( stats_now_ns() - deco.decode_time_ns );
+    }
+    return deco.block;
+}
+
+void Decoder::run(int budget)
+{
+    int steps = 0;
+    for( auto kv : _decoders )
+    {
+        if( budget > 0 && steps >= budget )
+        {
+            break;
+        }
+        steps += kv.second->run( budget > 0 ? budget - steps : 0 );
+    }
+}
+
+int Decoder::backlog()
+{
+    int ret = 0;
+    for( auto kv : _decoders )
+    {
+        ret += kv.second->backlog();
+    }
+    return ret;
+}
+
+void Decoder::setOutputLimits(const QueueLimits &limits)
+{
+    _outputLimits = limits;
+}
+
+uint64_t Decoder::droppedOutputCount()
+{
+    return _droppedOutputs.load( std::memory_order_relaxed );
+}
+
+size_t Decoder::memoryUse()
+{
+    size_t ret = _buffer->bytes();
+    for( auto kv : _decoders )
+    {
+        ret += kv.second->memoryUse();
+    }
+    return ret;
+}
+
+bool Decoder::isAccepting()
+{
+    return _outputLimits.dropPolicy != DROP_REJECT || !_outputLimits.full( _buffer->size(), _buffer->bytes() );
+}
+
+int Decoder::enforceOutputLimits()
+{
+    int dropped = 0;
+    if( _outputLimits.dropPolicy != DROP_REJECT )
+    {
+        while( _outputLimits.exceeded( _buffer->size(), _buffer->bytes() ) && _buffer->dropOldest() )
+        {
+            dropped++;
+        }
+    }
+    _droppedOutputs.fetch_add( dropped, std::memory_order_relaxed );
+    _outputBytes.set( _buffer->bytes() );
+    return dropped;
+}
+
+const StatsGauge &Decoder::outputBytes()
+{
+    return _outputBytes;
+}
+
+uint64_t Decoder::droppedBadChecksumCount()
+{
+    return _droppedBadChecksum.load( std::memory_order_relaxed );
+}
+
+uint64_t Decoder::droppedMalformedCount()
+{
+    return _droppedMalformed.load( std::memory_order_relaxed );
+}
+
+uint64_t Decoder::droppedRedundantCount()
+{
+    return _droppedRedundant.load( std::memory_order_relaxed );
+}
+
+bool Decoder::startRecording(const std::string &path)
+{
+    std::shared_ptr< TraceWriter > recorder = std::make_shared< TraceWriter >();
+    if( !recorder->open( path ) )
+    {
+        return false;
+    }
+    // Streams declared so far, so that the trace can be replayed on its own
+    for( auto kv : _decoders )
+    {
+        recorder->writeStreamAdded( kv.first, kv.second->_decodingWindowSize );
+    }
+    _recorder = recorder;
+    return true;
+}
+
+void Decoder::reset()
+{
+    std::fill( _recentFingerprints.begin(), _recentFingerprints.end(), 0 );
+    _buffer->clear();
+    _droppedBadChecksum.store( 0, std::memory_order_relaxed );
+    _droppedMalformed.store( 0, std::memory_order_relaxed );
+    _droppedRedundant.store( 0, std::memory_order_relaxed );
+    _droppedOutputs.store( 0, std::memory_order_relaxed );
+    _outputBytes.set( 0 );
+}
+
+void Decoder::stopRecording()
+{
+    _recorder = nullptr;
+}
+
+const LatencyHistogram &Decoder::decodeLatency()
+{
+    return _decodeLatency;
+}
+
+const LatencyHistogram &Decoder::reorderingDelay()
+{
+    return _reorderingDelay;
 }
@@ -1,6 +1,8 @@
 
 #include "encoder.h"
 
+#include <algorithm>
+
 
 Encoder::Encoder()
     :_curGlobalIdx(0)
@@ -16,6 +18,7 @@ Encoder::~Encoder()
 void Encoder::addStream(int streamId, StreamEncoder *encoder)
 {
     _encoders.insert( std::make_pair( streamId, encoder ) );
+    encoder->setStreamId( streamId );
     return;
 }
 
@@ -28,21 +31,44 @@ void Encoder::removeStream(int streamId)
     }
 }
 
-void Encoder::addData(int streamId, std::shared_ptr<SourceBlock> sb)
+int Encoder::addData(int streamId, std::shared_ptr<SourceBlock> sb)
 {
     // Find the right encoder...
-    if( _encoders.find( streamId ) != _encoders.end() )
+    auto kv = _encoders.find( streamId );
+    if( kv == _encoders.end() )
+    {
+        return -1;
+    }
+    if( !isAccepting( kv->second ) )
     {
-        StreamEncoder * se = _encoders[ streamId ];
-        sb->set_global_sequence_idx(_curGlobalIdx++);
-        se->addData(sb);
+        return QUEUE_REJECTED;
     }
+
+    uint64_t start = stats_now_ns();
+    StreamEncoder * se = kv->second;
+    sb->set_global_sequence_idx(_curGlobalIdx++);
+    int ret = se->addData(sb);
+    if( enforceLimits() > 0 )
+    {
+        ret = QUEUE_DROPPED;
+    }
+    _encodeLatency.record( stats_now_ns() - start );
+    return ret;
 }
 
-void Encoder::addData(int streamId, const void* buffer, int bufferSize)
+int Encoder::addData(int streamId, const void* buffer, int bufferSize)
 {
-    std::shared_ptr< SourceBlock > sb = std::make_shared<SourceBlock>(buffer, bufferSize);
-    return addData( streamId, sb );
+    // The stream allocates the block, from its arena if it has one
+    auto kv = _encoders.find( streamId );
+    if( kv == _encoders.end() )
+    {
+        return -1;
+    }
+    if( !isAccepting( kv->second ) )
+    {
+        return QUEUE_REJECTED;
+    }
+    return addData( streamId, kv->second->createSourceBlock( buffer, bufferSize ) );
 }
 
 bool Encoder::hasEncodedBlocks()
@@ -59,8 +85,95 @@ bool Encoder::hasEncodedBlocks()
     return ret;
 }
 
+void Encoder::setQueueLimits(const QueueLimits &limits)
+{
+    _limits = limits;
+}
+
+size_t Encoder::memoryUse()
+{
+    size_t ret = 0;
+    for( auto kv : _encoders )
+    {
+        ret += kv.second->memoryUse();
+    }
+    return ret;
+}
+
+bool Encoder::isAccepting(StreamEncoder *encoder)
+{
+    if( !encoder->isAccepting() )
+    {
+        return false;
+    }
+    if( _limits.dropPolicy != DROP_REJECT )
+    {
+        return true;
+    }
+    size_t count = queuedCount();
+    return count == 0 || !_limits.full( count, queuedBytes() );
+}
+
+int Encoder::enforceLimits()
+{
+    int dropped = 0;
+    if( _limits.dropPolicy == DROP_REJECT || (_limits.capacity == 0 && _limits.memoryBudget == 0) )
+    {
+        return 0;
+    }
+    while( _limits.exceeded( queuedCount(), queuedBytes() ) )
+    {
+        StreamEncoder * fullest = nullptr;
+        for( auto kv : _encoders )
+        {
+            if( kv.second->hasDroppableBlocks() && (fullest == nullptr || kv.second->queuedBytes() > fullest->queuedBytes()) )
+            {
+                fullest = kv.second;
+            }
+        }
+        if( fullest == nullptr || !fullest->dropEncodedBlock( _limits.dropPolicy == DROP_OLDEST_REPAIR ) )
+        {
+            break;
+        }
+        dropped++;
+    }
+    return dropped;
+}
+
+size_t Encoder::queuedBytes()
+{
+    size_t ret = 0;
+    for( auto kv : _encoders )
+    {
+        ret += kv.second->queuedBytes();
+    }
+    return ret;
+}
+
+size_t Encoder::queuedCount()
+{
+    size_t ret = 0;
+    for( auto kv : _encoders )
+    {
+        ret += kv.second->_codeBlocks.size();
+    }
+    return ret;
+}
+
+const LatencyHistogram &Encoder::encodeLatency()
+{
+    return _encodeLatency;
+}
+
 std::shared_ptr<CodeBlock> Encoder::getEncodedBlock()
 {
+    for( auto kv : _encoders )
+    {
+        if( !kv.second->_codeBlocks.empty() )
+        {
+            return kv.second->getEncodedBlock();
+        }
+    }
     for( auto kv : _encoders )
     {
         if( kv.second->hasEncodedBlocks() )
@@ -70,3 +183,31 @@ std::shared_ptr<CodeBlock> Encoder::getEncodedBlock()
     }
     return nullptr;
 }
+
+int Encoder::flushRepairs()
+{
+    int ret = 0;
+    for( auto kv : _encoders )
+    {
+        ret += kv.second->flushRepairs();
+    }
+    if( ret > 0 )
+    {
+        ret = std::max( 0, ret - enforceLimits() );
+    }
+    return ret;
+}
+
+int Encoder::poll(uint64_t nowNs)
+{
+    int ret = 0;
+    for( auto kv : _encoders )
+    {
+        ret += kv.second->poll( nowNs );
+    }
+    if( ret > 0 )
+    {
+        ret = std::max( 0, ret - enforceLimits() );
+    }
+    return ret;
+}
@@ -1,17 +1,251 @@
-
 #include "profiler.h"
 
-#ifdef USE_PROFILING
-#include <dollar.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define TRACE_HAS_RDTSC
+#endif
+
 using namespace std;
+
+namespace
+{
+
+struct TraceRing
+{
+    TraceRing( uint32_t tid )
+        :head(0), consumed(0), threadId(tid)
+    {
+    }
+
+    TraceEvent events[ TRACE_RING_SIZE ];
+    // Number of events ever written: only the owner thread writes it
+    std::atomic< uint64_t > head;
+    // Number of events already exported: only touched under g_traceMutex
+    uint64_t consumed;
+    uint32_t threadId;
+};
+
+// Rings are never freed, so that events of exited threads can still be exported
+std::mutex g_traceMutex;
+std::vector< std::unique_ptr< TraceRing > > g_traceRings;
+std::vector< const char* > g_traceScopes;
+
+// Matching tick and clock readings, to convert ticks to microseconds
+struct ClockPoint
+{
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+ClockPoint clockNow()
+{
+    ClockPoint p = { trace_ticks(), std::chrono::steady_clock::now() };
+    return p;
+}
+
+const ClockPoint& clockOrigin()
+{
+    static const ClockPoint origin = clockNow();
+    return origin;
+}
+
+TraceRing* threadRing()
+{
+    static thread_local TraceRing* ring = nullptr;
+    if( ring == nullptr )
+    {
+        std::lock_guard< std::mutex > lock( g_traceMutex );
+        g_traceRings.emplace_back( new TraceRing( (uint32_t)g_traceRings.size() ) );
+        ring = g_traceRings.back().get();
+    }
+    return ring;
+}
+
+struct ExportedEvent
+{
+    TraceEvent event;
+    uint32_t threadId;
+};
+
+// Copies the events written since the last export. Must hold g_traceMutex.
+std::vector< ExportedEvent > collectEvents()
+{
+    std::vector< ExportedEvent > ret;
+    for( std::unique_ptr< TraceRing >& ring : g_traceRings )
+    {
+        uint64_t head = ring->head.load( std::memory_order_acquire );
+        uint64_t from = std::max( ring->consumed, head > (uint64_t)TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0 );
+        size_t first = ret.size();
+        for( uint64_t i = from; i < head; ++i )
+        {
+            ExportedEvent e = { ring->events[ i & (TRACE_RING_SIZE - 1) ], ring->threadId };
+            ret.push_back( e );
+        }
+
+        // Drop the events the owner thread may have overwritten while they were copied
+        uint64_t after = ring->head.load( std::memory_order_acquire );
+        if( after > (uint64_t)TRACE_RING_SIZE && after - TRACE_RING_SIZE > from )
+        {
+            size_t overwritten = (size_t)std::min( after - TRACE_RING_SIZE - from, head - from );
+            ret.erase( ret.begin() + first, ret.begin() + first + overwritten );
+        }
+        ring->consumed = head;
+    }
+    return ret;
+}
+
+double ticksPerMicrosecond()
+{
+    const ClockPoint& origin = clockOrigin();
+    ClockPoint now = clockNow();
+    double us = std::chrono::duration< double, std::micro >( now.time - origin.time ).count();
+    if( us <= 0.0 || now.ticks <= origin.ticks )
+    {
+        return 1000.0;
+    }
+    return (now.ticks - origin.ticks) / us;
+}
+
+void writeJsonString( std::ostream& os, const char* s )
+{
+    os << '"';
+    for( ; *s; ++s )
+    {
+        if( *s == '"' || *s == '\\' )
+        {
+            os << '\\';
+        }
+        os << *s;
+    }
+    os << '"';
+}
+
+void writeChrome( std::ostream& os, const std::vector< ExportedEvent >& events )
+{
+    double tpus = ticksPerMicrosecond();
+    uint64_t originTicks = clockOrigin().ticks;
+
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision( 3 );
+
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    for( const ExportedEvent& e : events )
+    {
+        os << (first ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString( os, g_traceScopes[ e.event.scopeId ] );
+        os << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.threadId
+           << ",\"ts\":" << (double)(int64_t)(e.event.start - originTicks) / tpus
+           << ",\"dur\":" << (double)(e.event.end - e.event.start) / tpus << "}";
+        first = false;
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}" << endl;
+    os.flags( flags );
+    os.precision( precision );
+}
+
+void writeText( std::ostream& os, const std::vector< ExportedEvent >& events )
+{
+    double tpus = ticksPerMicrosecond();
+
+    struct ScopeTotal
+    {
+        uint64_t count;
+        uint64_t ticks;
+    };
+    std::map< uint32_t, ScopeTotal > totals;
+    for( const ExportedEvent& e : events )
+    {
+        ScopeTotal& t = totals[ e.event.scopeId ];
+        t.count++;
+        t.ticks += e.event.end - e.event.start;
+    }
+    for( const std::pair< const uint32_t, ScopeTotal >& t : totals )
+    {
+        double totalUs = t.second.ticks / tpus;
+        os << g_traceScopes[ t.first ] << ": " << t.second.count << " calls, " << totalUs << " us total, "
+           << totalUs / t.second.count << " us/call" << endl;
+    }
+}
+
+}
+
+uint32_t trace_register_scope(const char *name)
+{
+    clockOrigin();
+    std::lock_guard< std::mutex > lock( g_traceMutex );
+    g_traceScopes.push_back( name );
+    return (uint32_t)g_traceScopes.size() - 1;
+}
+
+uint64_t trace_ticks()
+{
+#ifdef TRACE_HAS_RDTSC
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile( "mrs %0, cntvct_el0" : "=r"( ticks ) );
+    return ticks;
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+void trace_record(uint32_t scopeId, uint64_t start, uint64_t end, uint32_t depth)
+{
+    TraceRing* ring = threadRing();
+    uint64_t head = ring->head.load( std::memory_order_relaxed );
+    TraceEvent& e = ring->events[ head & (TRACE_RING_SIZE - 1) ];
+    e.start = start;
+    e.end = end;
+    e.scopeId = scopeId;
+    e.depth = depth;
+    ring->head.store( head + 1, std::memory_order_release );
+}
+
+uint32_t &trace_depth()
+{
+    static thread_local uint32_t depth = 0;
+    return depth;
+}
+
+void trace_export_chrome(ostream &os)
+{
+    std::lock_guard< std::mutex > lock( g_traceMutex );
+    writeChrome( os, collectEvents() );
+}
+
+void trace_export_text(ostream &os)
+{
+    std::lock_guard< std::mutex > lock( g_traceMutex );
+    writeText( os, collectEvents() );
+}
+
+#ifdef USE_PROFILING
 void dump_profiling_info()
 {
+    std::lock_guard< std::mutex > lock( g_traceMutex );
+    std::vector< ExportedEvent > events = collectEvents();
+    writeText( std::cout, events );
     std::ofstream ofs("/tmp/trevi_profiling.json");
-    dollar::text(std::cout);                      // report stats to std::cout in text format; see also csv(), tsv() and markdown()
-    dollar::chrome(ofs); // write tracing results to a json file (for chrome://tracing embedded profiler)
-    dollar::clear();
-    ofs.close();
+    writeChrome( ofs, events );
 }
 #else
 void dump_profiling_info()
@@ -10,7 +10,7 @@ using namespace std;
 #include <unistd.h>
 #endif
 
-void ReorderingBuffer::addBlock(uint32_t stream_idx, uint32_t global_idx, std::shared_ptr<SourceBlock> sb)
+void ReorderingBuffer::addBlock(const DecodeOutput &deco)
 {
     // If the idx is far enough, reset buffer and start clean...
 
@@ -18,11 +18,10 @@ void ReorderingBuffer::addBlock(uint32_t stream_idx, uint32_t global_idx, std::s
     // Drop blocks until ok...
     while( _buffer.size() >= _windowSize )
     {
-        _outputQueue.push_back( _buffer.front().block );
-        _buffer.pop_front();
+        releaseFront();
     }
 
-    insert( stream_idx, global_idx, sb );
+    insert( deco );
 
 #ifdef USE_LOG
     dump();
@@ -31,6 +30,46 @@ void ReorderingBuffer::addBlock(uint32_t stream_idx, uint32_t global_idx, std::s
 
 }
 
+void ReorderingBuffer::flush()
+{
+    while( !_buffer.empty() )
+    {
+        releaseFront();
+    }
+    // Indices may start over after a flush (encoder restart)
+    _hasReleased = false;
+}
+
+void ReorderingBuffer::clear()
+{
+    _buffer.clear();
+    _outputQueue.clear();
+    _bytes = 0;
+    _hasReleased = false;
+}
+
+int ReorderingBuffer::release(uint64_t cutoffNs)
+{
+    int last = -1;
+    for( int k = 0; k < (int)_buffer.size(); ++k )
+    {
+        if( _buffer[k].decode_time_ns <= cutoffNs )
+        {
+            last = k;
+        }
+    }
+
+    // Blocks late for their turn are not held any longer either
+    int ret = 0;
+    while( !_buffer.empty()
+           && (ret <= last || (_hasReleased && !seq_before( _lastReleasedIdx + 1, _buffer.front().global_idx ))) )
+    {
+        releaseFront();
+        ret++;
+    }
+    return ret;
+}
+
 bool ReorderingBuffer::available()
 {
     return _outputQueue.size() > 0;
@@ -38,25 +77,67 @@ bool ReorderingBuffer::available()
 
 std::shared_ptr<SourceBlock> ReorderingBuffer::pop()
 {
-    std::shared_ptr<SourceBlock> ret = nullptr;
+    DecodeOutput deco;
+    if( pop( deco ) )
+    {
+        return deco.block;
+    }
+    return nullptr;
+}
+
+bool ReorderingBuffer::pop(DecodeOutput &deco)
+{
     if( _outputQueue.size() > 0 )
     {
-        ret = _outputQueue.front();
+        deco = _outputQueue.front();
         _outputQueue.pop_front();
+        _bytes -= deco.block->buffer_size();
+        return true;
     }
-    return ret;
+    return false;
 }
 
-void ReorderingBuffer::insert(uint32_t stream_idx, uint32_t global_idx, std::shared_ptr<SourceBlock> sb)
+bool ReorderingBuffer::dropOldest()
 {
-    DecodeOutput deco;
-    deco.block = sb;
-    deco.stream_idx = stream_idx;
-    deco.global_idx = global_idx;
+    std::deque< DecodeOutput >& queue = _outputQueue.empty() ? _buffer : _outputQueue;
+    if( queue.empty() )
+    {
+        return false;
+    }
+    _bytes -= queue.front().block->buffer_size();
+    queue.pop_front();
+    return true;
+}
+
+size_t ReorderingBuffer::size()
+{
+    return _buffer.size() + _outputQueue.size();
+}
+
+size_t ReorderingBuffer::bytes()
+{
+    return _bytes;
+}
+
+void ReorderingBuffer::insert(const DecodeOutput &deco)
+{
+    _bytes += deco.block->buffer_size();
     _buffer.push_back( deco );
     std::sort( _buffer.begin(), _buffer.end(), DecodeOutputComparator() );
 }
 
+void ReorderingBuffer::releaseFront()
+{
+    const DecodeOutput& front = _buffer.front();
+    if( !_hasReleased || seq_before( _lastReleasedIdx, front.global_idx ) )
+    {
+        _lastReleasedIdx = front.global_idx;
+        _hasReleased = true;
+    }
+    _outputQueue.push_back( front );
+    _buffer.pop_front();
+}
+
 void ReorderingBuffer::dump()
 {
     cerr << "~~~~ REORDERING BUFFER:" << endl;
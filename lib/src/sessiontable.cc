@@ -0,0 +1,376 @@
+#include "sessiontable.h"
+
+#include "codeblock.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+bool SessionKey::set(const void *addr, int addrSize, uint32_t session, uint8_t stream)
+{
+    if( addrSize < 0 || addrSize > MAX_ADDRESS_SIZE || (addrSize > 0 && addr == nullptr) )
+    {
+        return false;
+    }
+    // Unused address bytes are zeroed, so that keys can be compared whole
+    memset( address, 0, sizeof(address) );
+    if( addrSize > 0 )
+    {
+        memcpy( address, addr, addrSize );
+    }
+    addressSize = (uint8_t)addrSize;
+    streamId = stream;
+    sessionId = session;
+    return true;
+}
+
+uint64_t SessionKey::hash() const
+{
+    // FNV-1a, then a final mix so that the low bits depend on every byte
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for( int k = 0; k < addressSize; ++k )
+    {
+        h = (h ^ address[k]) * 0x100000001b3ULL;
+    }
+    h = (h ^ sessionId) * 0x100000001b3ULL;
+    h = (h ^ ((uint64_t)streamId << 8 | addressSize)) * 0x100000001b3ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+bool SessionKey::operator==(const SessionKey &other) const
+{
+    return sessionId == other.sessionId && streamId == other.streamId && addressSize == other.addressSize
+            && memcmp( address, other.address, addressSize ) == 0;
+}
+
+SessionTable::SessionTable(int decodingWindowSize, uint64_t idleTimeoutNs)
+    :_decodingWindowSize(decodingWindowSize), _idleTimeoutNs(idleTimeoutNs), _lazyPayloads(false), _inactivation(false), _workBudget(0),
+      _count(0), _oldest(-1), _newest(-1), _evicted(0), _droppedMalformed(0)
+{
+    Slot empty = { 0, 0 };
+    _slots.assign( 64, empty );
+}
+
+SessionTable::~SessionTable()
+{
+
+}
+
+bool SessionTable::addCodeBlock(const void *address, int addressSize, uint32_t sessionId, const void *buffer, int bufferSize, uint64_t nowNs)
+{
+    TREVI_TRACE_SCOPE();
+
+    evictIdle( nowNs );
+
+    CodeBlockHeader header;
+    SessionKey key;
+    if( !header.read( buffer, bufferSize ) || !key.set( address, addressSize, sessionId, header.streamId ) )
+    {
+        _droppedMalformed++;
+        return false;
+    }
+
+    uint64_t hash = key.hash();
+    int session = find( key, hash );
+    if( session < 0 )
+    {
+        session = create( key, hash );
+    }
+
+    Session& s = _pool[ session ];
+    s.lastActiveNs = nowNs;
+    if( _newest != session )
+    {
+        unlink( session );
+        pushNewest( session );
+    }
+
+    s.decoder->addCodeBlock( buffer, bufferSize );
+    if( !s.ready && s.decoder->available() )
+    {
+        s.ready = true;
+        _ready.push_back( session );
+    }
+    return true;
+}
+
+bool SessionTable::available()
+{
+    return !_orphans.empty() || !_ready.empty();
+}
+
+bool SessionTable::pop(SessionOutput &out)
+{
+    if( !_orphans.empty() )
+    {
+        out = _orphans.front();
+        _orphans.pop_front();
+        return true;
+    }
+    if( _ready.empty() )
+    {
+        return false;
+    }
+
+    // One packet per session in turn, so that a busy session does not starve the others
+    int session = _ready.front();
+    _ready.pop_front();
+    Session& s = _pool[ session ];
+    out.key = s.key;
+    out.block = s.decoder->pop();
+    if( s.decoder->available() )
+    {
+        _ready.push_back( session );
+    }
+    else
+    {
+        s.ready = false;
+    }
+    return true;
+}
+
+int SessionTable::evictIdle(uint64_t nowNs)
+{
+    int ret = 0;
+    while( _oldest >= 0 && nowNs - _pool[ _oldest ].lastActiveNs > _idleTimeoutNs )
+    {
+        evict( _oldest );
+        ret++;
+    }
+    return ret;
+}
+
+void SessionTable::setLazyPayloads(bool lazy)
+{
+    _lazyPayloads = lazy;
+}
+
+void SessionTable::setInactivation(bool inactivation)
+{
+    _inactivation = inactivation;
+}
+
+void SessionTable::setWorkBudget(int budget)
+{
+    _workBudget = budget;
+}
+
+int SessionTable::sessionCount()
+{
+    return _count;
+}
+
+uint64_t SessionTable::evictedCount()
+{
+    return _evicted;
+}
+
+uint64_t SessionTable::droppedMalformedCount()
+{
+    return _droppedMalformed;
+}
+
+const StreamStats &SessionTable::stats()
+{
+    return _stats;
+}
+
+int SessionTable::find(const SessionKey &key, uint64_t hash)
+{
+    size_t mask = _slots.size() - 1;
+    for( size_t i = hash & mask; _slots[i].session != 0; i = (i + 1) & mask )
+    {
+        int session = _slots[i].session - 1;
+        if( _slots[i].hash == (uint32_t)hash && _pool[ session ].key == key )
+        {
+            return session;
+        }
+    }
+    return -1;
+}
+
+int SessionTable::create(const SessionKey &key, uint64_t hash)
+{
+    int session;
+    if( !_freeSessions.empty() )
+    {
+        session = _freeSessions.back();
+        _freeSessions.pop_back();
+    }
+    else
+    {
+        session = (int)_pool.size();
+        _pool.emplace_back();
+    }
+
+    Session& s = _pool[ session ];
+    s.key = key;
+    s.hash = hash;
+    s.ready = false;
+    s.older = -1;
+    s.newer = -1;
+    if( !_spareDecoders.empty() )
+    {
+        s.decoder = std::move( _spareDecoders.back().decoder );
+        s.streamDecoder = std::move( _spareDecoders.back().streamDecoder );
+        _spareDecoders.pop_back();
+    }
+    else
+    {
+        s.decoder.reset( new Decoder( SESSION_DUPLICATE_FILTER_SIZE, false ) );
+        s.streamDecoder.reset( new StreamDecoder( _decodingWindowSize, &_stats ) );
+    }
+    s.streamDecoder->setLazyPayloads( _lazyPayloads );
+    s.streamDecoder->setInactivation( _inactivation );
+    s.streamDecoder->setWorkBudget( _workBudget );
+    s.decoder->addStream( key.streamId, s.streamDecoder.get() );
+    pushNewest( session );
+
+    if( 2 * (_count + 1) > (int)_slots.size() )
+    {
+        grow();
+    }
+    insertSlot( (uint32_t)hash, session );
+    _count++;
+    return session;
+}
+
+void SessionTable::evict(int session)
+{
+    Session& s = _pool[ session ];
+
+    // What was decoded is still handed out, after what is queued already
+    s.decoder->flush();
+    while( s.decoder->available() )
+    {
+        SessionOutput out;
+        out.key = s.key;
+        out.block = s.decoder->pop();
+        _orphans.push_back( out );
+    }
+    if( s.ready )
+    {
+        _ready.erase( std::find( _ready.begin(), _ready.end(), session ) );
+        s.ready = false;
+    }
+
+    eraseSlot( (uint32_t)s.hash, session );
+    unlink( session );
+    s.decoder->removeStream( s.key.streamId );
+    if( (int)_spareDecoders.size() < SPARE_DECODERS_MAX )
+    {
+        s.decoder->reset();
+        s.streamDecoder->reset();
+        SpareDecoder spare;
+        spare.decoder = std::move( s.decoder );
+        spare.streamDecoder = std::move( s.streamDecoder );
+        _spareDecoders.push_back( std::move( spare ) );
+    }
+    s.decoder.reset();
+    s.streamDecoder.reset();
+    _freeSessions.push_back( session );
+    _count--;
+    _evicted++;
+}
+
+void SessionTable::insertSlot(uint32_t hash, int session)
+{
+    size_t mask = _slots.size() - 1;
+    size_t i = hash & mask;
+    while( _slots[i].session != 0 )
+    {
+        i = (i + 1) & mask;
+    }
+    _slots[i].hash = hash;
+    _slots[i].session = session + 1;
+}
+
+// Backward shift deletion: the entries after the hole which would not be
+// found anymore move into it, so that no tombstones are needed
+void SessionTable::eraseSlot(uint32_t hash, int session)
+{
+    size_t mask = _slots.size() - 1;
+    size_t i = hash & mask;
+    while( _slots[i].session != (uint32_t)session + 1 )
+    {
+        i = (i + 1) & mask;
+    }
+
+    size_t j = i;
+    for( ;; )
+    {
+        j = (j + 1) & mask;
+        if( _slots[j].session == 0 )
+        {
+            break;
+        }
+        // The entry at j may move to i only if its home slot is not in (i, j]
+        size_t home = _slots[j].hash & mask;
+        if( ((j - home) & mask) >= ((j - i) & mask) )
+        {
+            _slots[i] = _slots[j];
+            i = j;
+        }
+    }
+    _slots[i].hash = 0;
+    _slots[i].session = 0;
+}
+
+void SessionTable::grow()
+{
+    std::vector< Slot > old;
+    old.swap( _slots );
+    Slot empty = { 0, 0 };
+    _slots.assign( 2 * old.size(), empty );
+    for( const Slot& slot : old )
+    {
+        if( slot.session != 0 )
+        {
+            insertSlot( slot.hash, slot.session - 1 );
+        }
+    }
+}
+
+void SessionTable::unlink(int session)
+{
+    Session& s = _pool[ session ];
+    if( s.older >= 0 )
+    {
+        _pool[ s.older ].newer = s.newer;
+    }
+    else if( _oldest == session )
+    {
+        _oldest = s.newer;
+    }
+    if( s.newer >= 0 )
+    {
+        _pool[ s.newer ].older = s.older;
+    }
+    else if( _newest == session )
+    {
+        _newest = s.older;
+    }
+    s.older = -1;
+    s.newer = -1;
+}
+
+void SessionTable::pushNewest(int session)
+{
+    Session& s = _pool[ session ];
+    s.older = _newest;
+    s.newer = -1;
+    if( _newest >= 0 )
+    {
+        _pool[ _newest ].newer = session;
+    }
+    else
+    {
+        _oldest = session;
+    }
+    _newest = session;
+}
@@ -37,6 +37,8 @@
 #include <errno.h>
 #endif
 
+#include <string.h>
+
 // Fix missing definitions (mainly for MinGW):
 
 #if !defined(IPV6_V6ONLY)
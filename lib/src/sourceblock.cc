@@ -9,19 +9,27 @@
 
 using namespace std;
 
-SourceBlock::SourceBlock(const void* payloadBuffer, int payloadSize)
+SourceBlock::SourceBlock(const void* payloadBuffer, int payloadSize, BlockArena *arena, uint32_t slot)
+    :_rawCRC(0), _rawCRCType(CHECKSUM_UNKNOWN)
 {
-    initMemory( payloadSize + SOURCEBLOCK_HEADER_SIZE + SOURCEBLOCK_FOOTER_SIZE );
+    initMemory( payloadSize + SOURCEBLOCK_HEADER_SIZE + SOURCEBLOCK_FOOTER_SIZE, arena, slot );
     memcpy( payload_ptr(), payloadBuffer, payloadSize );
     setPayloadSize( payloadSize );
 }
 
 SourceBlock::SourceBlock(int bufferSize, uint8_t *rawBuffer)
+    :_rawCRC(0), _rawCRCType(CHECKSUM_UNKNOWN)
 {
     initMemory( bufferSize );
     memcpy( buffer_ptr(), rawBuffer, bufferSize );
 }
 
+SourceBlock::SourceBlock(std::shared_ptr<void> rawBufferRef, int bufferSize)
+    :_rawCRC(0), _rawCRCType(CHECKSUM_UNKNOWN)
+{
+    shareMemory( rawBufferRef, bufferSize );
+}
+
 SourceBlock::~SourceBlock()
 {
 
@@ -47,6 +55,7 @@ uint32_t SourceBlock::get_global_sequence_idx()
 void SourceBlock::set_global_sequence_idx(uint32_t value)
 {
     uint8_t* gidxPtr = (uint8_t*)buffer_ptr() + SOURCEBLOCK_GLOBAL_SEQ_IDX_OFFSET;
+    _rawCRCType = CHECKSUM_UNKNOWN;
     return write32ToBuffer( gidxPtr, value );
 }
 
@@ -59,6 +68,10 @@ void SourceBlock::updateCRC()
 {
     uint16_t crcValue = computeCRC();
     write16ToBuffer( footer_ptr(), crcValue );
+
+    // CRC-16 of the whole buffer only needs the footer bytes on top of it
+    _rawCRC = crc16_update( crcValue, (const char*)footer_ptr(), SOURCEBLOCK_FOOTER_SIZE );
+    _rawCRCType = CHECKSUM_CRC16;
 }
 
 uint16_t SourceBlock::readCRC()
@@ -72,6 +85,16 @@ uint16_t SourceBlock::computeCRC()
     return crcValue;
 }
 
+uint32_t SourceBlock::rawBufferCRC(uint8_t checksumType)
+{
+    if( _rawCRCType != checksumType )
+    {
+        _rawCRC = checksum_raw( checksumType, buffer_ptr(), buffer_size() );
+        _rawCRCType = checksumType;
+    }
+    return _rawCRC;
+}
+
 bool SourceBlock::isCorrectCRC()
 {
     uint16_t rValue = readCRC();
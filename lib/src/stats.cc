@@ -0,0 +1,193 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+static std::atomic< int > g_nextThreadShard( 0 );
+
+int stats_thread_shard()
+{
+    static thread_local int shard = g_nextThreadShard.fetch_add( 1, std::memory_order_relaxed ) % STATS_MAX_SHARDS;
+    return shard;
+}
+
+StatsCounter::StatsCounter()
+{
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        _cells[i].value.store( 0, std::memory_order_relaxed );
+    }
+}
+
+uint64_t StatsCounter::value() const
+{
+    uint64_t ret = 0;
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        ret += _cells[i].value.load( std::memory_order_relaxed );
+    }
+    return ret;
+}
+
+LatencyHistogram::Shard::Shard()
+    :total(0), sum(0), min(std::numeric_limits<uint64_t>::max()), max(0)
+{
+    for( int i = 0; i < BUCKET_COUNT; ++i )
+    {
+        counts[i].store( 0, std::memory_order_relaxed );
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        _shards[i].store( nullptr, std::memory_order_relaxed );
+    }
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        delete _shards[i].load( std::memory_order_relaxed );
+    }
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    Shard* s = shard();
+    s->counts[ bucketIndex( ns ) ].fetch_add( 1, std::memory_order_relaxed );
+    s->total.fetch_add( 1, std::memory_order_relaxed );
+    s->sum.fetch_add( ns, std::memory_order_relaxed );
+
+    // The loops only run when a new extreme is seen
+    uint64_t cur = s->min.load( std::memory_order_relaxed );
+    while( ns < cur && !s->min.compare_exchange_weak( cur, ns, std::memory_order_relaxed ) )
+    {
+    }
+    cur = s->max.load( std::memory_order_relaxed );
+    while( ns > cur && !s->max.compare_exchange_weak( cur, ns, std::memory_order_relaxed ) )
+    {
+    }
+}
+
+std::vector<uint64_t> LatencyHistogram::bucketCounts() const
+{
+    std::vector< uint64_t > counts( BUCKET_COUNT, 0 );
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        Shard* s = _shards[i].load( std::memory_order_acquire );
+        if( s == nullptr )
+        {
+            continue;
+        }
+        for( int b = 0; b < BUCKET_COUNT; ++b )
+        {
+            counts[b] += s->counts[b].load( std::memory_order_relaxed );
+        }
+    }
+    return counts;
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary ret = { 0, 0, 0, 0.0, 0, 0, 0, 0 };
+
+    std::vector< uint64_t > counts = bucketCounts();
+    uint64_t sum = 0;
+    uint64_t minNs = std::numeric_limits<uint64_t>::max();
+    for( int i = 0; i < STATS_MAX_SHARDS; ++i )
+    {
+        Shard* s = _shards[i].load( std::memory_order_acquire );
+        if( s == nullptr )
+        {
+            continue;
+        }
+        sum += s->sum.load( std::memory_order_relaxed );
+        minNs = std::min( minNs, s->min.load( std::memory_order_relaxed ) );
+        ret.maxNs = std::max( ret.maxNs, s->max.load( std::memory_order_relaxed ) );
+    }
+
+    // Shards are read one after the other: use the bucket counts as the reference
+    for( int b = 0; b < BUCKET_COUNT; ++b )
+    {
+        ret.count += counts[b];
+    }
+    if( ret.count == 0 )
+    {
+        return ret;
+    }
+    ret.minNs = minNs;
+    ret.meanNs = (double)sum / ret.count;
+
+    const double quantiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+    uint64_t* outputs[4] = { &ret.p50Ns, &ret.p90Ns, &ret.p99Ns, &ret.p999Ns };
+    for( int q = 0; q < 4; ++q )
+    {
+        uint64_t target = (uint64_t)(quantiles[q] * ret.count);
+        uint64_t acc = 0;
+        *outputs[q] = ret.maxNs;
+        for( int b = 0; b < BUCKET_COUNT; ++b )
+        {
+            acc += counts[b];
+            if( acc > target )
+            {
+                *outputs[q] = std::min( bucketUpperBound( b ), ret.maxNs );
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+int LatencyHistogram::bucketIndex(uint64_t v)
+{
+    if( v < SUB_BUCKETS )
+    {
+        return (int)v;
+    }
+    int msb = 63;
+    while( !(v >> msb) )
+    {
+        msb--;
+    }
+    if( msb >= MAX_VALUE_BITS )
+    {
+        return BUCKET_COUNT - 1;
+    }
+    int shift = msb - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if( bucket < SUB_BUCKETS )
+    {
+        return bucket;
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+LatencyHistogram::Shard *LatencyHistogram::shard()
+{
+    std::atomic< Shard* >& slot = _shards[ stats_thread_shard() ];
+    Shard* s = slot.load( std::memory_order_acquire );
+    if( s == nullptr )
+    {
+        Shard* fresh = new Shard();
+        if( slot.compare_exchange_strong( s, fresh, std::memory_order_acq_rel ) )
+        {
+            s = fresh;
+        }
+        else
+        {
+            delete fresh; // Another thread sharing this shard was faster
+        }
+    }
+    return s;
+}
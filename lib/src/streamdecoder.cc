@@ -3,23 +3,29 @@
 #include "ogesolver.h"
 #include "decoder.h"
 
-#ifdef USE_PROFILING
 #include "profiler.h"
-#endif
 
 #include <memory>
 #include <iostream>
 
 using namespace std;
 
-StreamDecoder::StreamDecoder(uint16_t decodingWindowSize)
-    :_parent(nullptr), _decodingWindowSize(decodingWindowSize)
+StreamDecoder::StreamDecoder(uint16_t decodingWindowSize, StreamStats* sharedStats)
+    :_decodingWindowSize(decodingWindowSize), _stats(sharedStats), _parent(nullptr)
 {
+    if( _stats == nullptr )
+    {
+        _ownStats.reset( new StreamStats() );
+        _stats = _ownStats.get();
+    }
     _curMinSeqIdx = 0;
     _curMaxSeqIdx = 0;
-    _infPacketIdxCount = 0;
+    _firstSeqIdx = -1;
+    _epoch = 0;
+    _previousEpoch = 0;
+    _hasPreviousEpoch = false;
+    _memoryStatsCountdown = 0;
     _oge = std::make_shared<OGESolver>( _decodingWindowSize );
-    _buffer = std::make_shared<ReorderingBuffer>( _decodingWindowSize );
 }
 
 StreamDecoder::~StreamDecoder()
@@ -32,42 +38,47 @@ void StreamDecoder::addCodeBlock(uint8_t *buffer, int bufferSize)
 
 }
 
-void StreamDecoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
+int StreamDecoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
 {
 
-#ifdef USE_PROFILING
-    $
-        #endif
+    TREVI_TRACE_SCOPE();
+
+    if( !isAccepting() )
+    {
+        return QUEUE_REJECTED;
+    }
 
-            std::set< uint32_t > compo = cb->getCompositionSet();
-    auto minSeqIdx = *compo.begin();
-    auto maxSeqIdx = *compo.rbegin();
+    Composition compo = cb->composition();
+    uint32_t minSeqIdx = compo.front();
+    uint32_t maxSeqIdx = compo.back();
+    uint32_t epoch = cb->get_epoch();
+
+    _stats->packetsIn.add();
+    if( _firstSeqIdx < 0 )
+    {
+        _epoch = epoch;
+        anchor( minSeqIdx );
+    }
 
 #ifdef USE_LOG
     cerr << "block_min=" << minSeqIdx << " block_max=" <<maxSeqIdx << endl;
 #endif
 
     // Check if encoder has reset ?
-    // cerr << "minSeqIdx=" << minSeqIdx << " - _curMinSeqIdx=" << _curMinSeqIdx << " _infPacketIdxCount=" << _infPacketIdxCount << endl;
-    if( minSeqIdx < _curMinSeqIdx )
+    if( epoch != _epoch )
     {
-        _infPacketIdxCount++;
-        if( _infPacketIdxCount > _decodingWindowSize )
+        if( _hasPreviousEpoch && epoch == _previousEpoch )
         {
-#ifdef _WIN32
-            ::_sleep(1000);
-#else
-            sleep(1);
-#endif
-            _curMinSeqIdx = minSeqIdx;
-            _curMaxSeqIdx = minSeqIdx;
-            _oge->reset();
-            _infPacketIdxCount = 0;
+            return QUEUE_ACCEPTED; // Late block from before the restart
         }
+        _previousEpoch = _epoch;
+        _hasPreviousEpoch = true;
+        _epoch = epoch;
+        resync( minSeqIdx );
     }
 
     // Resize to the right...
-    if( maxSeqIdx > _curMaxSeqIdx )
+    if( seq_before( _curMaxSeqIdx, maxSeqIdx ) )
     {
 #ifdef USE_LOG
         cerr << "resize to the right..." << endl;
@@ -75,32 +86,132 @@ void StreamDecoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
         _curMaxSeqIdx = maxSeqIdx + 1;
     }
 
-    // Compute new span if any...
-    int span = _curMaxSeqIdx - _curMinSeqIdx;
-
     // Resize to the left...
-    int targetMin = max( (int)0, (int)(_curMaxSeqIdx - _decodingWindowSize + 1)  );
-    _curMinSeqIdx = targetMin;
+    _curMinSeqIdx = _curMaxSeqIdx - _decodingWindowSize + 1;
 
-    // cerr << "_curMaxSeqIdx=" << _curMaxSeqIdx << " _curMinSeqIdx=" << _curMinSeqIdx << endl;
-
-    if( _curMinSeqIdx > _oge->offset() )
+    if( seq_before( _oge->offset(), _curMinSeqIdx ) )
     {
+        // Blocks leaving the window undecoded are lost for good
+        _stats->unrecoverable.add( _oge->undecodedCount( (uint32_t)_firstSeqIdx, _curMinSeqIdx ) );
         _oge->shiftWindowTo( _curMinSeqIdx );
     }
 
-    // cerr << std::dec << "New min/max values: " << _curMinSeqIdx << " - " << _curMaxSeqIdx << endl;
-
     _oge->addBlock( cb );
+    int dropped = enforceLimits();
 
 #ifdef USE_LOG
     cerr << "Number of undetermined blocks: " << _oge->undeterminedCount();
 #endif
 
-    while( _oge->_output.size() > 0 )
+    drainOutputs();
+
+    // Walking the window is not free: only refreshed every few blocks
+    if( --_memoryStatsCountdown <= 0 )
     {
-        DecodeOutput doutput = _oge->_output.front();
-        _oge->_output.pop_front();
+        _stats->memoryBytes.set( _oge->memoryUse() );
+        _memoryStatsCountdown = MEMORY_STATS_PERIOD;
+    }
+
+    return dropped > 0 ? QUEUE_DROPPED : QUEUE_ACCEPTED;
+}
+
+void StreamDecoder::setQueueLimits(const QueueLimits &limits)
+{
+    _limits = limits;
+}
+
+const QueueLimits &StreamDecoder::queueLimits()
+{
+    return _limits;
+}
+
+size_t StreamDecoder::memoryUse()
+{
+    return _oge->memoryUse();
+}
+
+bool StreamDecoder::isAccepting()
+{
+    if( _limits.dropPolicy != DROP_REJECT || _oge->pendingCount() == 0 )
+    {
+        return true;
+    }
+    return !_limits.full( _oge->pendingCount(), _oge->pendingBytes() );
+}
+
+int StreamDecoder::enforceLimits()
+{
+    if( _limits.dropPolicy == DROP_REJECT || (_limits.capacity == 0 && _limits.memoryBudget == 0) )
+    {
+        return 0;
+    }
+    int dropped = 0;
+    while( _oge->pendingCount() > 0
+           && _limits.exceeded( _oge->pendingCount(), _oge->pendingBytes() )
+           && _oge->dropPending( _limits.dropPolicy == DROP_OLDEST_REPAIR ) )
+    {
+        dropped++;
+    }
+    if( dropped > 0 )
+    {
+        _stats->dropped.add( dropped );
+    }
+    return dropped;
+}
+
+// Restarts decoding from seqIdx, without waiting: blocks of the previous
+// session still undecoded are lost
+void StreamDecoder::resync(uint32_t seqIdx)
+{
+    if( seq_before( _oge->offset(), _curMaxSeqIdx ) )
+    {
+        _stats->unrecoverable.add( _oge->undecodedCount( (uint32_t)_firstSeqIdx, _curMaxSeqIdx ) );
+    }
+    _stats->resyncs.add();
+    _oge->reset();
+    anchor( seqIdx );
+    if( _parent )
+    {
+        _parent->onStreamResync();
+    }
+}
+
+// Places the window so that it ends with seqIdx, wherever the encoder counter
+// is: blocks sent before it may still arrive out of order
+void StreamDecoder::anchor(uint32_t seqIdx)
+{
+    _curMaxSeqIdx = seqIdx;
+    _curMinSeqIdx = seqIdx - _decodingWindowSize + 1;
+    _oge->setOffset( _curMinSeqIdx );
+    _firstSeqIdx = seqIdx;
+}
+
+int StreamDecoder::run(int budget)
+{
+    int steps = _oge->run( budget );
+    drainOutputs();
+    return steps;
+}
+
+int StreamDecoder::backlog()
+{
+    return _oge->backlog();
+}
+
+void StreamDecoder::setWorkBudget(int budget)
+{
+    _oge->setWorkBudget( budget );
+}
+
+void StreamDecoder::drainOutputs()
+{
+    for( const DecodeOutput& doutput : _oge->_output )
+    {
+        _stats->packetsOut.add();
+        if( doutput.recovered )
+        {
+            _stats->recovered.add();
+        }
         if( _parent )
         {
 #ifdef USE_LOG
@@ -109,19 +220,63 @@ void StreamDecoder::addCodeBlock(std::shared_ptr<CodeBlock> cb)
             _parent->onNewDecodeOutput(doutput);
         }
     }
+    _oge->_output.clear();
+
+    _stats->solverRank.set( _oge->rank() );
+    _stats->windowOccupancy.set( _curMaxSeqIdx - _curMinSeqIdx );
+    _stats->backlog.set( _oge->backlog() );
+    int expired = _oge->takeExpiredCount();
+    if( expired > 0 )
+    {
+        _stats->expired.add( expired );
+    }
+}
+
+bool StreamDecoder::isSolved(uint32_t epoch, const Composition &compo)
+{
+    // Blocks of another epoch are about a different sequence
+    return _firstSeqIdx >= 0 && epoch == _epoch && _oge->isSolved( compo );
+}
 
-    // _oge->dump();
+void StreamDecoder::setLazyPayloads(bool lazy)
+{
+    _oge->setLazyPayloads( lazy );
+}
+
+void StreamDecoder::setInactivation(bool inactivation)
+{
+    _oge->setInactivation( inactivation );
+}
 
+bool StreamDecoder::setBlockArena(int maxPayloadSize)
+{
+    if( maxPayloadSize == 0 )
+    {
+        _oge->setBlockArena( nullptr );
+        return true;
+    }
+    // Decoded blocks are handed out without copy and may keep their slot a
+    // while after leaving the window: twice as many slots as window rows.
+    std::shared_ptr< BlockArena > arena = BlockArena::create( maxPayloadSize, 2 * _decodingWindowSize );
+    _oge->setBlockArena( arena );
+    return arena != nullptr;
 }
 
-bool StreamDecoder::available()
+const StreamStats &StreamDecoder::stats()
 {
-    return _buffer->available();
+    return *_stats;
 }
 
-std::shared_ptr<SourceBlock> StreamDecoder::pop()
+void StreamDecoder::reset()
 {
-    return _buffer->pop();
+    _curMinSeqIdx = 0;
+    _curMaxSeqIdx = 0;
+    _firstSeqIdx = -1;
+    _epoch = 0;
+    _previousEpoch = 0;
+    _hasPreviousEpoch = false;
+    _memoryStatsCountdown = 0;
+    _oge->reset();
 }
 
 void StreamDecoder::setParent(Decoder *parent)
@@ -3,183 +3,569 @@
 #include "gf256.h"
 #include "profiler.h"
 
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include <random>
-#include <set>
 #include <chrono>
 #include <iomanip>
+#include <new>
+#include <vector>
 
+#include <cstdlib>
 #include <cstring>
 
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
 using namespace std;
 
 StreamEncoder::StreamEncoder(int encodingWindowSize, int numSourceBlockPerCodeBlock, int numCodeBlockPerSourceBlock)
-    :_encodingWindowSize(encodingWindowSize), _numSourceBlockPerCodeBlock(numSourceBlockPerCodeBlock), _numCodeBlockPerSourceBlock(numCodeBlockPerSourceBlock)
+    :_encodingWindowSize(encodingWindowSize), _numSourceBlockPerCodeBlock(numSourceBlockPerCodeBlock), _numCodeBlockPerSourceBlock(numCodeBlockPerSourceBlock), _checksumType(CHECKSUM_CRC16), _streamId(0),
+      _selectionPolicy(SELECTION_UNIFORM), _includeNewest(false), _parityColumns(0), _parityRows(0), _parityPosition(0), _deferredRepair(false),
+      _tailIdleNs(0), _lastDataNs(0), _tailProtected(true)
 {
+    static_assert( (WINDOW_CAPACITY & (WINDOW_CAPACITY - 1)) == 0, "Window capacity must be a power of two" );
+
+    // Compositions cannot span more than Composition::MAX_SPAN blocks anyway
+    _encodingWindowSize = max( 1, min( encodingWindowSize, (int)WINDOW_CAPACITY ) );
+#ifdef _WIN32
+    _window = (EncodingWindow*)_aligned_malloc( sizeof(EncodingWindow), 64 );
+#else
+    void* window = nullptr;
+    _window = posix_memalign( &window, 64, sizeof(EncodingWindow) ) == 0 ? (EncodingWindow*)window : nullptr;
+#endif
+    if( _window == nullptr )
+    {
+        throw std::bad_alloc();
+    }
     init();
 }
 
 StreamEncoder::~StreamEncoder()
 {
-
+#ifdef _WIN32
+    _aligned_free( _window );
+#else
+    free( _window );
+#endif
 }
 
-void StreamEncoder::addData(std::shared_ptr<SourceBlock> cb)
+int StreamEncoder::addData(std::shared_ptr<SourceBlock> cb)
 {
 
-#ifdef USE_PROFILING
-    $
-#endif
+    TREVI_TRACE_SCOPE();
+
+    if( !isAccepting() )
+    {
+        return QUEUE_REJECTED;
+    }
 
-    // Add to encoding buffer
+    // Add to encoding buffer. The source CRC is computed once here, code block
+    // CRCs are then derived from it.
     cb->updateCRC();
+    _stats.packetsIn.add();
     pushSourceBlock(cb);
+    if( _tailIdleNs > 0 )
+    {
+        _lastDataNs = stats_now_ns();
+    }
+    _tailProtected = false;
 
-    if( _encodingWindow.size() > 0 && _curSeqIdx % _numSourceBlockPerCodeBlock == 0 )
+    if( _parityColumns > 0 )
     {
-        for( int j = 0; j < _numCodeBlockPerSourceBlock; ++j )
-        {
-            auto polbak = createEncodedBlock( pickDegree() );
-            if( polbak != nullptr )
-            {
-                _codeBlocks.push_back( polbak );
-            }
-        }
+        createParityBlocks();
     }
+    else if( _windowCount > 0 && _curSeqIdx % _numSourceBlockPerCodeBlock == 0 )
+    {
+        createEncodedBlocks( _numCodeBlockPerSourceBlock );
+    }
+
+    return enforceLimits() > 0 ? QUEUE_DROPPED : QUEUE_ACCEPTED;
 }
 
-void StreamEncoder::addData(uint8_t *buffer, int bufferSize)
+int StreamEncoder::addData(uint8_t *buffer, int bufferSize)
 {
-    std::shared_ptr< SourceBlock > cb = std::make_shared<SourceBlock>( buffer, bufferSize );
-    addData( cb );
+    return addData( createSourceBlock( buffer, bufferSize ) );
 }
 
 void StreamEncoder::dumpEncodingWindow()
 {
-    for( int i = 0; i < _encodingWindow.size(); ++i )
+    for( int k = 0; k < _windowCount; ++k )
     {
-        cerr << _encodingWindow[i] << " ";
+        cerr << _window->seqIdx[ windowSlot( k ) ] << " ";
     }
     cerr << endl;
 }
 
+void StreamEncoder::setChecksumType(uint8_t type)
+{
+    _checksumType = type;
+    for( int k = 0; k < _windowCount; ++k )
+    {
+        int slot = windowSlot( k );
+        _window->crc[ slot ] = _windowBlocks[ slot ]->rawBufferCRC( _checksumType );
+    }
+}
+
+void StreamEncoder::setSelectionPolicy(uint8_t policy)
+{
+    _selectionPolicy = policy;
+}
+
+void StreamEncoder::setIncludeNewest(bool includeNewest)
+{
+    _includeNewest = includeNewest;
+}
+
+void StreamEncoder::setStreamId(uint8_t streamId)
+{
+    _streamId = streamId;
+}
+
+bool StreamEncoder::setBlockArena(int maxPayloadSize)
+{
+    if( maxPayloadSize == 0 )
+    {
+        _arena = nullptr;
+        return true;
+    }
+    // One more slot than the window: the oldest block leaves the window after the new one is created
+    _arena = BlockArena::create( maxPayloadSize, _encodingWindowSize + 1 );
+    return _arena != nullptr;
+}
+
+std::shared_ptr<SourceBlock> StreamEncoder::createSourceBlock(const void *buffer, int bufferSize)
+{
+    return std::make_shared<SourceBlock>( buffer, bufferSize, _arena.get(), _curSeqIdx );
+}
+
+bool StreamEncoder::setParityMatrix(int columns, int rows)
+{
+    // A column parity spans the whole matrix, which must fit in a composition
+    if( columns < 0 || rows < 1 || columns * rows > WINDOW_CAPACITY )
+    {
+        return false;
+    }
+    // Pending compositions were picked for the current window size
+    encodePendingRepairs();
+    _parityColumns = columns;
+    _parityRows = rows;
+    _parityPosition = 0;
+    return true;
+}
+
+void StreamEncoder::setDeferredRepair(bool deferred)
+{
+    _deferredRepair = deferred;
+    if( !deferred )
+    {
+        flushRepairs();
+    }
+}
+
+int StreamEncoder::flushRepairs()
+{
+    int ret = encodePendingRepairs();
+    if( ret > 0 )
+    {
+        // Only what the limits left queued is ready
+        ret = std::max( 0, ret - enforceLimits() );
+    }
+    return ret;
+}
+
+bool StreamEncoder::hasPendingRepairs()
+{
+    return !_pendingRepairs.empty();
+}
+
+void StreamEncoder::setTailProtection(uint64_t idleNs)
+{
+    _tailIdleNs = idleNs;
+    _lastDataNs = stats_now_ns();
+}
+
+int StreamEncoder::poll(uint64_t nowNs)
+{
+    if( _tailIdleNs == 0 || _tailProtected || _windowCount == 0 || nowNs - _lastDataNs < _tailIdleNs )
+    {
+        return 0;
+    }
+    _tailProtected = true;
+
+    // Tail blocks are built at once, after what was still deferred
+    int ret = encodePendingRepairs();
+    size_t queued = _codeBlocks.size();
+    createTailBlocks();
+    ret += (int)(_codeBlocks.size() - queued);
+    return std::max( 0, ret - enforceLimits() );
+}
+
 bool StreamEncoder::hasEncodedBlocks()
 {
-    return _codeBlocks.size() > 0;
+    return _codeBlocks.size() > 0 || _pendingRepairs.size() > 0;
 }
 
 std::shared_ptr<CodeBlock> StreamEncoder::getEncodedBlock()
 {
     std::shared_ptr< CodeBlock > ret = nullptr;
-    if( hasEncodedBlocks() )
+    // Repair blocks are only built once the blocks before them are out
+    if( _codeBlocks.empty() )
+    {
+        flushRepairs();
+    }
+    if( !_codeBlocks.empty() )
     {
         ret = _codeBlocks.front();
         _codeBlocks.pop_front();
+        if( ret.get() == _newestSource )
+        {
+            _newestSource = nullptr;
+        }
+        _queuedBytes -= ret->buffer_size();
+        _stats.memoryBytes.set( memoryUse() );
     }
     return ret;
 }
 
+void StreamEncoder::setQueueLimits(const QueueLimits &limits)
+{
+    _limits = limits;
+}
+
+const QueueLimits &StreamEncoder::queueLimits()
+{
+    return _limits;
+}
+
+bool StreamEncoder::isAccepting()
+{
+    // Only waiting blocks count: the window alone may be over the budget
+    return _limits.dropPolicy != DROP_REJECT || _codeBlocks.empty() || !_limits.full( _codeBlocks.size(), _queuedBytes );
+}
+
+bool StreamEncoder::dropEncodedBlock(bool repairFirst)
+{
+    const CodeBlock* spared = _newestSource;
+    auto victim = std::find_if( _codeBlocks.begin(), _codeBlocks.end(),
+                                [spared]( const std::shared_ptr< CodeBlock >& cb ) { return cb.get() != spared; } );
+    if( victim == _codeBlocks.end() )
+    {
+        return false;
+    }
+    if( repairFirst )
+    {
+        auto repair = std::find_if( victim, _codeBlocks.end(),
+                                    []( const std::shared_ptr< CodeBlock >& cb ) { return cb->composition().size() > 1; } );
+        if( repair != _codeBlocks.end() )
+        {
+            victim = repair;
+        }
+    }
+    _queuedBytes -= (*victim)->buffer_size();
+    _codeBlocks.erase( victim );
+    _stats.dropped.add();
+    _stats.memoryBytes.set( memoryUse() );
+    return true;
+}
+
+bool StreamEncoder::hasDroppableBlocks()
+{
+    // The newest source block, if still waiting, is one of the queued blocks
+    return _codeBlocks.size() > (_newestSource != nullptr ? 1u : 0u);
+}
+
+size_t StreamEncoder::memoryUse()
+{
+    return _windowBytes + _queuedBytes;
+}
+
+size_t StreamEncoder::queuedBytes()
+{
+    return _queuedBytes;
+}
+
+void StreamEncoder::queueEncodedBlock(std::shared_ptr<CodeBlock> cb)
+{
+    _queuedBytes += cb->buffer_size();
+    _codeBlocks.push_back( cb );
+    _stats.packetsOut.add();
+}
+
+int StreamEncoder::enforceLimits()
+{
+    int dropped = 0;
+    if( _limits.dropPolicy != DROP_REJECT )
+    {
+        while( _limits.exceeded( _codeBlocks.size(), _queuedBytes ) && dropEncodedBlock( _limits.dropPolicy == DROP_OLDEST_REPAIR ) )
+        {
+            dropped++;
+        }
+    }
+    _stats.memoryBytes.set( memoryUse() );
+    return dropped;
+}
+
+const StreamStats &StreamEncoder::stats()
+{
+    return _stats;
+}
+
 void StreamEncoder::init()
 {
     _curSeqIdx = 0;
+    _windowHead = 0;
+    _windowCount = 0;
+    _windowBytes = 0;
+    _queuedBytes = 0;
+    _newestSource = nullptr;
     srand( time(NULL) );
     generator.seed(std::chrono::system_clock::now().time_since_epoch().count());
     degree_generator.seed(std::chrono::system_clock::now().time_since_epoch().count());
+
+    // A new epoch for every start, so that decoders detect restarts at once
+    std::random_device rd;
+    do
+    {
+        _epoch = rd() ^ (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    while( _epoch == 0 );
 }
 
 void StreamEncoder::pushSourceBlock(std::shared_ptr<SourceBlock> cb)
 {
-    if( _encodingWindow.size() >= _encodingWindowSize )
+    // The window holds exactly one parity matrix in parity mode
+    int windowSize = _parityColumns > 0 ? _parityColumns * _parityRows : (int)_encodingWindowSize;
+    if( _windowCount >= windowSize )
+    {
+        // The oldest block is about to leave: what still has to include it is built now
+        encodePendingRepairs();
+    }
+    while( _windowCount >= windowSize )
     {
-        _encodingWindow.pop_front();
-        _sourceBlockBuffer.pop_front();
+        _windowBytes -= _window->size[ _windowHead ];
+        _windowBlocks[ _windowHead ] = nullptr;
+        _windowHead = windowSlot( 1 );
+        _windowCount--;
     }
-    _encodingWindow.push_back( _curSeqIdx );
-    _sourceBlockBuffer.push_back( cb );
+    int slot = windowSlot( _windowCount++ );
+    _window->seqIdx[ slot ] = _curSeqIdx;
+    _window->size[ slot ] = cb->buffer_size();
+    _windowBytes += cb->buffer_size();
+    _window->crc[ slot ] = cb->rawBufferCRC( _checksumType );
+    _window->coverage[ slot ] = 0;
+    _window->buffer[ slot ] = (const uint8_t*)cb->buffer_ptr();
+    _windowBlocks[ slot ] = cb;
 
     // Also output the degree 1 block immediatly
     std::shared_ptr< CodeBlock > d1cb = std::make_shared< CodeBlock >( cb->buffer_size(), (uint8_t*)cb->buffer_ptr(), cb->buffer_size() );
-    std::set<uint32_t> compoSet;
-    compoSet.insert(0);
-    d1cb->setCompositionField(_curSeqIdx, compoSet );
-    _codeBlocks.push_back( d1cb );
+    d1cb->setComposition( Composition( _curSeqIdx, 1 ) );
+    d1cb->set_stream_id( _streamId );
+    d1cb->set_epoch( _epoch );
+    d1cb->setChecksumType( _checksumType );
+    d1cb->updateCRC( cb->rawBufferCRC( _checksumType ) );
+    queueEncodedBlock( d1cb );
+    _newestSource = d1cb.get();
+    _stats.windowOccupancy.set( _windowCount );
 
     _curSeqIdx++;
 }
 
 uint32_t StreamEncoder::oldestSeqIdx()
 {
-    return _encodingWindow.front();
+    return _window->seqIdx[ _windowHead ];
 }
 
 uint32_t StreamEncoder::latestSeqIdx()
 {
-    return _encodingWindow.back();
+    return _window->seqIdx[ windowSlot( _windowCount - 1 ) ];
 }
 
-std::shared_ptr<CodeBlock> StreamEncoder::createEncodedBlock(uint16_t degree)
+void StreamEncoder::createEncodedBlocks(int count)
 {
 
-    std::set<uint32_t> compoSet;
-    std::uniform_int_distribution<int> distribution(0,_encodingWindow.size()-1);
-    while( compoSet.size() != degree )
+    TREVI_TRACE_SCOPE();
+
+    // Pick the compositions first: indices are relative to the oldest block of the window
+    std::vector< Composition > compos;
+    std::uniform_int_distribution<int> distribution(0,_windowCount-1);
+    for( int j = 0; j < count; ++j )
     {
-        // Select a source packet at random
-        int number = distribution(generator);
-        int seqNum = _encodingWindow[ number ];
-        if( compoSet.find( number ) == compoSet.end() )
+        uint16_t degree = pickDegree();
+        Composition compo( 0, 0 );
+        if( _includeNewest )
+        {
+            compo.insert( _windowCount - 1 );
+        }
+        while( compo.size() != degree )
         {
-            compoSet.insert( number );
+            compo.insert( pickSourceBlock( compo, distribution ) );
         }
+        compos.push_back( compo );
     }
 
-    // Compute MTU for current set of blocks
-    int maxBlockSize = 0;
-    std::set<uint32_t>::iterator it;
-    for (it=compoSet.begin(); it!=compoSet.end(); ++it)
+    emitRepairBlocks( compos );
+}
+
+// The blocks of the window would all have been in the coming repair blocks,
+// the newest ones most: the tail is the whole window. The first tail block is
+// their XOR, which recovers a single loss wherever it is, the others random
+// combinations, as many as repair blocks per source block.
+void StreamEncoder::createTailBlocks()
+{
+
+    TREVI_TRACE_SCOPE();
+
+    std::vector< Composition > compos;
+    Composition all( 0, 0 );
+    for( int k = 0; k < _windowCount; ++k )
     {
-        int idx = *it;
-        std::shared_ptr< SourceBlock > curCb = _sourceBlockBuffer[ idx ];
-        if( curCb->buffer_size() > maxBlockSize )
+        all.insert( k );
+    }
+    compos.push_back( all );
+
+    std::uniform_int_distribution<int> coin( 0, 1 );
+    for( int j = 1; j < min( _numCodeBlockPerSourceBlock, _windowCount ); ++j )
+    {
+        Composition compo( 0, 0 );
+        while( compo.size() == 0 )
         {
-            maxBlockSize = curCb->buffer_size();
+            for( int k = 0; k < _windowCount; ++k )
+            {
+                if( coin( generator ) )
+                {
+                    compo.insert( k );
+                }
+            }
         }
+        compos.push_back( compo );
     }
 
-    uint8_t* tmpBuffer_A = (uint8_t*)alloca(maxBlockSize);
-    uint8_t* tmpBuffer_B = (uint8_t*)alloca(maxBlockSize);
-    memset( tmpBuffer_A, 0, maxBlockSize );
+    encodeBlocks( compos );
+}
 
-    //    std::cout << "set:" << endl;
-    //    printSet( compoSet );
-    //    std::cout << "....." << endl;
+void StreamEncoder::createParityBlocks()
+{
 
-    // std::cout << "set:" << endl;
-    for (it=compoSet.begin(); it!=compoSet.end(); ++it)
+    TREVI_TRACE_SCOPE();
+
+    // The newest source block is the last one of the window, at position
+    // pos of the matrix, filled row by row
+    const int matrixSize = _parityColumns * _parityRows;
+    int pos = _parityPosition;
+    _parityPosition = (_parityPosition + 1) % matrixSize;
+    int newest = _windowCount - 1;
+
+    // Single source rows or columns would only duplicate it
+    std::vector< Composition > compos;
+    if( _parityColumns > 1 && pos % _parityColumns == _parityColumns - 1 )
     {
-        int idx = *it;
-        std::shared_ptr< SourceBlock > curCb = _sourceBlockBuffer[ idx ];
-        memset( tmpBuffer_B, 0, maxBlockSize );
-        memcpy( tmpBuffer_B, curCb->buffer_ptr(), curCb->buffer_size() );
-        gf256_add_mem( tmpBuffer_A, tmpBuffer_B, maxBlockSize );
-        // dumbXOR( tmpBuffer_A, tmpBuffer_B, maxBlockSize );
+        Composition row( 0, 0 );
+        for( int c = 0; c < _parityColumns; ++c )
+        {
+            row.insert( newest - c );
+        }
+        compos.push_back( row );
+    }
+    if( _parityRows > 1 && pos == matrixSize - 1 )
+    {
+        int first = newest - (matrixSize - 1);
+        for( int c = 0; c < _parityColumns; ++c )
+        {
+            Composition column( 0, 0 );
+            for( int r = 0; r < _parityRows; ++r )
+            {
+                column.insert( first + c + r * _parityColumns );
+            }
+            compos.push_back( column );
+        }
     }
 
-    //    if( degree == 1 )
-    //        print_bytes( cerr, "addData_sb", (unsigned char*)tmpBuffer, maxBlockSize, true );
+    if( !compos.empty() )
+    {
+        emitRepairBlocks( compos );
+    }
+}
 
-    std::shared_ptr< CodeBlock > cbcode = std::make_shared<CodeBlock>( maxBlockSize, (uint8_t*)tmpBuffer_A, (int)maxBlockSize );
-    //    if( degree == 1 )
-    //        print_bytes( cerr, "addData_cb", (unsigned char*)cbcode->payload_ptr(), cbcode->payload_size(), true );
+void StreamEncoder::emitRepairBlocks(const std::vector<Composition> &compos)
+{
+    if( _deferredRepair )
+    {
+        _pendingRepairs.insert( _pendingRepairs.end(), compos.begin(), compos.end() );
+    }
+    else
+    {
+        encodeBlocks( compos );
+    }
+}
 
-    cbcode->setCompositionField( oldestSeqIdx(), compoSet );
-    //    cerr << "dump compofield" << endl;
-    //    cbcode->dumpCompositionField();
-    //    cerr << "......" << endl;
-    cbcode->updateCRC();
+int StreamEncoder::encodePendingRepairs()
+{
+    if( _pendingRepairs.empty() )
+    {
+        return 0;
+    }
+    int ret = (int)_pendingRepairs.size();
+    encodeBlocks( _pendingRepairs );
+    _pendingRepairs.clear();
+    return ret;
+}
+
+void StreamEncoder::encodeBlocks(const std::vector<Composition> &compos)
+{
 
-    return cbcode;
+    TREVI_TRACE_SCOPE();
+
+    const int count = (int)compos.size();
+    std::vector< std::shared_ptr< CodeBlock > > blocks;
+    std::vector< uint32_t > rawPayloadCRCs( count, 0 );
+    for( const Composition& compo : compos )
+    {
+        // Compute MTU for current set of blocks
+        int maxBlockSize = 0;
+        for( uint32_t idx : compo )
+        {
+            maxBlockSize = max( maxBlockSize, _window->size[ windowSlot( idx ) ] );
+        }
+        blocks.push_back( std::make_shared<CodeBlock>( maxBlockSize ) );
+    }
+
+    // Then read each source block once, XORing it into every code block which
+    // includes it: shorter blocks are implicitly zero padded
+    void** dests = (void**)alloca( count * sizeof(void*) );
+    for( int k = 0; k < _windowCount; ++k )
+    {
+        int slot = windowSlot( k );
+        int size = _window->size[ slot ];
+        int n = 0;
+        for( int j = 0; j < count; ++j )
+        {
+            if( compos[j].contains( k ) )
+            {
+                dests[ n++ ] = blocks[j]->payload_ptr();
+                // CRC linearity: the CRC of the XOR is the XOR of the (zero padded) CRCs
+                rawPayloadCRCs[j] ^= checksum_pad( _checksumType, _window->crc[ slot ], blocks[j]->payload_size() - size );
+            }
+        }
+        if( n > 0 )
+        {
+            gf256_addn_mem( dests, n, _window->buffer[ slot ], size );
+            _window->coverage[ slot ] += n;
+        }
+    }
+
+    for( int j = 0; j < count; ++j )
+    {
+        std::shared_ptr< CodeBlock > cbcode = blocks[j];
+        cbcode->setComposition( Composition( oldestSeqIdx(), compos[j].mask() ) );
+        cbcode->set_stream_id( _streamId );
+        cbcode->set_epoch( _epoch );
+        cbcode->setChecksumType( _checksumType );
+        cbcode->updateCRC( rawPayloadCRCs[j] );
+        queueEncodedBlock( cbcode );
+    }
 
 }
 
@@ -188,8 +574,30 @@ std::shared_ptr<CodeBlock> StreamEncoder::selectRandomSourceBlock()
     return nullptr;
 }
 
+// Window position of a source block to add to compo. The balanced policy
+// draws two candidates and keeps the least covered one (power of two
+// choices): under-covered blocks catch up, without scanning the window.
+// Coverage is relative to the time spent in the window, so that the newest
+// blocks are not favored just for being new.
+int StreamEncoder::pickSourceBlock(const Composition &compo, std::uniform_int_distribution<int> &distribution)
+{
+    int k = distribution(generator);
+    if( _selectionPolicy == SELECTION_BALANCED )
+    {
+        int other = distribution(generator);
+        // coverage( other ) / age( other ) < coverage( k ) / age( k ), with age( k ) = _windowCount - k
+        int64_t otherScore = (int64_t)_window->coverage[ windowSlot( other ) ] * (_windowCount - k);
+        int64_t score = (int64_t)_window->coverage[ windowSlot( k ) ] * (_windowCount - other);
+        if( !compo.contains( other ) && (compo.contains( k ) || otherScore < score) )
+        {
+            k = other;
+        }
+    }
+    return k;
+}
+
 uint16_t StreamEncoder::pickDegree()
 {
-    std::uniform_int_distribution<int> distribution(1, min((int)_encodingWindowSize, (int)_encodingWindow.size()) );
+    std::uniform_int_distribution<int> distribution(1, min((int)_encodingWindowSize, _windowCount) );
     return distribution(degree_generator);
 }
@@ -0,0 +1,219 @@
+#include "tracefile.h"
+#include "wire.h"
+
+#include <cstring>
+
+using namespace std;
+
+static const char TRACE_MAGIC[4] = { 'T', 'R', 'V', 'T' };
+static const uint16_t TRACE_VERSION = 1;
+static const int TRACE_HEADER_SIZE = 8;
+
+// Records are flushed regularly, so that a trace stays usable if the process is killed
+static const int TRACE_FLUSH_INTERVAL = 256;
+
+TraceWriter::TraceWriter()
+    :_lastTimestampUs(0), _recordsSinceFlush(0)
+{
+
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(const string &path)
+{
+    close();
+    _ofs.open( path, ios::out | ios::binary | ios::trunc );
+    if( !_ofs.is_open() )
+    {
+        return false;
+    }
+
+    uint8_t header[ TRACE_HEADER_SIZE ] = { 0 };
+    memcpy( header, TRACE_MAGIC, sizeof(TRACE_MAGIC) );
+    write16ToBuffer( header + 4, TRACE_VERSION );
+    _ofs.write( (const char*)header, TRACE_HEADER_SIZE );
+
+    _start = std::chrono::steady_clock::now();
+    _lastTimestampUs = 0;
+    _recordsSinceFlush = 0;
+    return _ofs.good();
+}
+
+void TraceWriter::close()
+{
+    if( _ofs.is_open() )
+    {
+        _ofs.close();
+    }
+}
+
+bool TraceWriter::isOpen()
+{
+    return _ofs.is_open();
+}
+
+void TraceWriter::writePacket(const void *buffer, int bufferSize)
+{
+    if( !isOpen() || bufferSize < 0 )
+    {
+        return;
+    }
+    writeRecordHeader( TRACE_RECORD_PACKET );
+    writeVarint( bufferSize );
+    _ofs.write( (const char*)buffer, bufferSize );
+}
+
+void TraceWriter::writeStreamAdded(uint8_t streamId, uint32_t decodingWindowSize)
+{
+    if( !isOpen() )
+    {
+        return;
+    }
+    writeRecordHeader( TRACE_RECORD_STREAM_ADDED );
+    _ofs.put( (char)streamId );
+    writeVarint( decodingWindowSize );
+}
+
+void TraceWriter::writeStreamRemoved(uint8_t streamId)
+{
+    if( !isOpen() )
+    {
+        return;
+    }
+    writeRecordHeader( TRACE_RECORD_STREAM_REMOVED );
+    _ofs.put( (char)streamId );
+}
+
+void TraceWriter::writeRecordHeader(uint8_t type)
+{
+    uint64_t now = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - _start ).count();
+    if( ++_recordsSinceFlush >= TRACE_FLUSH_INTERVAL )
+    {
+        _ofs.flush();
+        _recordsSinceFlush = 0;
+    }
+    _ofs.put( (char)type );
+    writeVarint( now - _lastTimestampUs );
+    _lastTimestampUs = now;
+}
+
+void TraceWriter::writeVarint(uint64_t value)
+{
+    uint8_t buf[ 10 ];
+    int n = 0;
+    do
+    {
+        uint8_t b = value & 0x7F;
+        value >>= 7;
+        buf[ n++ ] = b | (value ? 0x80 : 0);
+    } while( value );
+    _ofs.write( (const char*)buf, n );
+}
+
+TraceReader::TraceReader()
+    :_timestampUs(0)
+{
+
+}
+
+TraceReader::~TraceReader()
+{
+
+}
+
+bool TraceReader::open(const string &path)
+{
+    _ifs.open( path, ios::in | ios::binary );
+    if( !_ifs.is_open() )
+    {
+        return false;
+    }
+
+    uint8_t header[ TRACE_HEADER_SIZE ];
+    if( !_ifs.read( (char*)header, TRACE_HEADER_SIZE ) )
+    {
+        return false;
+    }
+    if( memcmp( header, TRACE_MAGIC, sizeof(TRACE_MAGIC) ) != 0 || read16FromBuffer( header + 4 ) != TRACE_VERSION )
+    {
+        return false;
+    }
+    _timestampUs = 0;
+    return true;
+}
+
+bool TraceReader::next(TraceRecord &record)
+{
+    int type = _ifs.get();
+    if( type == EOF )
+    {
+        return false;
+    }
+
+    uint64_t delta;
+    if( !readVarint( delta ) )
+    {
+        return false;
+    }
+    _timestampUs += delta;
+
+    record.type = (uint8_t)type;
+    record.timestampUs = _timestampUs;
+    record.streamId = 0;
+    record.decodingWindowSize = 0;
+    record.data.clear();
+
+    uint64_t value;
+    switch( record.type )
+    {
+    case TRACE_RECORD_PACKET:
+        if( !readVarint( value ) || value > 0xFFFF )
+        {
+            return false;
+        }
+        record.data.resize( (size_t)value );
+        return value == 0 || (bool)_ifs.read( (char*)record.data.data(), (std::streamsize)value );
+    case TRACE_RECORD_STREAM_ADDED:
+        type = _ifs.get();
+        if( type == EOF || !readVarint( value ) )
+        {
+            return false;
+        }
+        record.streamId = (uint8_t)type;
+        record.decodingWindowSize = (uint32_t)value;
+        return true;
+    case TRACE_RECORD_STREAM_REMOVED:
+        type = _ifs.get();
+        if( type == EOF )
+        {
+            return false;
+        }
+        record.streamId = (uint8_t)type;
+        return true;
+    default:
+        return false; // Unknown record, can't know its size
+    }
+}
+
+bool TraceReader::readVarint(uint64_t &value)
+{
+    value = 0;
+    for( int shift = 0; shift < 64; shift += 7 )
+    {
+        int b = _ifs.get();
+        if( b == EOF )
+        {
+            return false;
+        }
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if( !(b & 0x80) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,6 +1,8 @@
 
 #include "trevi.h"
 #include "gf256.h"
+#include "crc16.h"
+#include "crc32c.h"
 
 #include "encoder.h"
 
@@ -15,6 +17,51 @@ using namespace std;
 void trevi_init()
 {
     int initret = gf256_init();
+    crc16_init();
+    crc32c_init();
+}
+
+const char * trevi_get_simd_path()
+{
+    return gf256_simd_path_name( gf256_get_simd_path() );
+}
+
+static_assert( TREVI_DROP_OLDEST_REPAIR == DROP_OLDEST_REPAIR && TREVI_DROP_OLDEST == DROP_OLDEST && TREVI_DROP_REJECT == DROP_REJECT, "Drop policies" );
+static_assert( TREVI_OK == QUEUE_ACCEPTED && TREVI_DROPPED == QUEUE_DROPPED && TREVI_BACKPRESSURE == QUEUE_REJECTED, "Queue return codes" );
+
+// Stream options shared by encoders and decoders
+static int setQueueLimitsOption( QueueLimits& limits, trevi_stream_option option, int value )
+{
+    switch( option )
+    {
+    case TREVI_STREAM_QUEUE_CAPACITY:
+        if( value < 0 )
+            return -1;
+        limits.capacity = value;
+        break;
+    case TREVI_STREAM_MEMORY_BUDGET:
+        if( value < 0 )
+            return -1;
+        limits.memoryBudget = (size_t)value;
+        break;
+    case TREVI_STREAM_DROP_POLICY:
+        if( value != TREVI_DROP_OLDEST_REPAIR && value != TREVI_DROP_OLDEST && value != TREVI_DROP_REJECT )
+            return -1; // Unknown policy
+        limits.dropPolicy = (uint8_t)value;
+        break;
+    default:
+        return -1;
+    }
+    return 0;
+}
+
+static int makeQueueLimits( int capacity, long long memoryBudget, trevi_drop_policy policy, QueueLimits* limits )
+{
+    if( capacity < 0 || memoryBudget < 0 )
+        return -1;
+    limits->capacity = capacity;
+    limits->memoryBudget = (size_t)memoryBudget;
+    return setQueueLimitsOption( *limits, TREVI_STREAM_DROP_POLICY, policy );
 }
 
 
@@ -49,21 +96,109 @@ int trevi_encoder_add_stream(trevi_encoder *encoder, int streamId, int encodingW
 }
 
 
-int trevi_encode(trevi_encoder *encoder, int streamId, const void *buffer, int bufferSize)
+int trevi_encoder_set_stream_option(trevi_encoder *encoder, int streamId, trevi_stream_option option, int value)
 {
+    if( streamId < 0 || streamId >= 32 || encoder->streamEncoderRefs[streamId] == nullptr )
+        return -1; // Unknown stream
+
+    StreamEncoder * streamEnc = reinterpret_cast<StreamEncoder*>(encoder->streamEncoderRefs[streamId]);
+    switch( option )
+    {
+    case TREVI_ENCODER_CHECKSUM:
+        if( value != TREVI_CHECKSUM_CRC16 && value != TREVI_CHECKSUM_CRC32C )
+            return -1; // Unknown checksum
+        streamEnc->setChecksumType( value == TREVI_CHECKSUM_CRC32C ? CHECKSUM_CRC32C : CHECKSUM_CRC16 );
+        break;
+    case TREVI_ENCODER_BLOCK_ARENA:
+        if( value < 0 || value > 65535 || !streamEnc->setBlockArena( value ) )
+            return -1; // Invalid size, or no memory
+        break;
+    case TREVI_STREAM_QUEUE_CAPACITY:
+    case TREVI_STREAM_MEMORY_BUDGET:
+    case TREVI_STREAM_DROP_POLICY:
+    {
+        QueueLimits limits = streamEnc->queueLimits();
+        if( setQueueLimitsOption( limits, option, value ) != 0 )
+            return -1;
+        streamEnc->setQueueLimits( limits );
+        break;
+    }
+    case TREVI_ENCODER_SELECTION:
+        if( value != TREVI_SELECTION_UNIFORM && value != TREVI_SELECTION_BALANCED )
+            return -1; // Unknown policy
+        streamEnc->setSelectionPolicy( value == TREVI_SELECTION_BALANCED ? SELECTION_BALANCED : SELECTION_UNIFORM );
+        break;
+    case TREVI_ENCODER_INCLUDE_NEWEST:
+        streamEnc->setIncludeNewest( value != 0 );
+        break;
+    case TREVI_ENCODER_DEFERRED_REPAIR:
+        streamEnc->setDeferredRepair( value != 0 );
+        break;
+    case TREVI_ENCODER_TAIL_PROTECTION:
+        if( value < 0 )
+            return -1;
+        streamEnc->setTailProtection( (uint64_t)value * 1000000 );
+        break;
+    default:
+        return -1; // Not an encoder option
+    }
+
+    return 0;
+}
+
+
+int trevi_encoder_set_stream_parity(trevi_encoder *encoder, int streamId, int columns, int rows)
+{
+    if( streamId < 0 || streamId >= 32 || encoder->streamEncoderRefs[streamId] == nullptr )
+        return -1; // Unknown stream
+
+    StreamEncoder * streamEnc = reinterpret_cast<StreamEncoder*>(encoder->streamEncoderRefs[streamId]);
+    if( !streamEnc->setParityMatrix( columns, rows ) )
+        return -1; // Does not fit in a window
+
+    return 0;
+}
+
+
+int trevi_encoder_set_queue_limits(trevi_encoder *encoder, int capacity, long long memoryBudget, trevi_drop_policy policy)
+{
+    QueueLimits limits;
+    if( makeQueueLimits( capacity, memoryBudget, policy, &limits ) != 0 )
+        return -1;
     Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
-    enc->addData( streamId, buffer, bufferSize );
+    enc->setQueueLimits( limits );
     return 0;
 }
 
+int trevi_encode(trevi_encoder *encoder, int streamId, const void *buffer, int bufferSize)
+{
+    Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
+    return enc->addData( streamId, buffer, bufferSize );
+}
+
+
+int trevi_encoder_flush_repair(trevi_encoder *encoder)
+{
+    Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
+    return enc->flushRepairs();
+}
+
+
+int trevi_encoder_poll(trevi_encoder *encoder)
+{
+    Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
+    return enc->poll( stats_now_ns() );
+}
+
 
 int trevi_encoder_get_encoded_data(trevi_encoder *encoder, void *out_buffer)
 {
      Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
 
-     if( enc->hasEncodedBlocks() )
+     // Deferred repair blocks may all be dropped by the queue limits as soon as built
+     std::shared_ptr< CodeBlock > cb = enc->hasEncodedBlocks() ? enc->getEncodedBlock() : nullptr;
+     if( cb != nullptr )
      {
-         std::shared_ptr< CodeBlock > cb = enc->getEncodedBlock();
          memcpy( out_buffer, cb->buffer_ptr(), cb->buffer_size() );
          return cb->buffer_size();
      }
@@ -103,14 +238,104 @@ int trevi_decoder_add_stream(trevi_decoder *decoder, int streamId, int decodingW
 }
 
 
+int trevi_decoder_set_stream_option(trevi_decoder *decoder, int streamId, trevi_stream_option option, int value)
+{
+    if( streamId < 0 || streamId >= 32 || decoder->streamDecoderRefs[streamId] == nullptr )
+        return -1; // Unknown stream
+
+    StreamDecoder * streamDec = reinterpret_cast<StreamDecoder*>(decoder->streamDecoderRefs[streamId]);
+    switch( option )
+    {
+    case TREVI_DECODER_LAZY_PAYLOADS:
+        streamDec->setLazyPayloads( value != 0 );
+        break;
+    case TREVI_DECODER_BLOCK_ARENA:
+        if( value < 0 || value > 65535 || !streamDec->setBlockArena( value ) )
+            return -1; // Invalid size, or no memory
+        break;
+    case TREVI_DECODER_INACTIVATION:
+        streamDec->setInactivation( value != 0 );
+        break;
+    case TREVI_DECODER_WORK_BUDGET:
+        if( value < 0 )
+            return -1;
+        streamDec->setWorkBudget( value );
+        break;
+    case TREVI_STREAM_QUEUE_CAPACITY:
+    case TREVI_STREAM_MEMORY_BUDGET:
+    case TREVI_STREAM_DROP_POLICY:
+    {
+        QueueLimits limits = streamDec->queueLimits();
+        if( setQueueLimitsOption( limits, option, value ) != 0 )
+            return -1;
+        streamDec->setQueueLimits( limits );
+        break;
+    }
+    default:
+        return -1; // Not a decoder option
+    }
+
+    return 0;
+}
+
+
+int trevi_decoder_remove_stream(trevi_decoder *decoder, int streamId)
+{
+    if( streamId < 0 || streamId >= 32 || decoder->streamDecoderRefs[streamId] == nullptr )
+        return -1; // No such stream
+
+    StreamDecoder * streamDec = reinterpret_cast<StreamDecoder*>(decoder->streamDecoderRefs[streamId]);
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    dec->removeStream( streamId );
+    decoder->streamDecoderRefs[ streamId ] = nullptr;
+    delete streamDec;
+
+    return 0;
+}
+
 int trevi_decode(trevi_decoder *decoder, const void *buffer, int bufferSize)
 {
     Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
-    dec->addCodeBlock(buffer, bufferSize);
+    return dec->addCodeBlock(buffer, bufferSize);
+}
+
+int trevi_decoder_set_output_limits(trevi_decoder *decoder, int capacity, long long memoryBudget, trevi_drop_policy policy)
+{
+    QueueLimits limits;
+    if( makeQueueLimits( capacity, memoryBudget, policy, &limits ) != 0 )
+        return -1;
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    dec->setOutputLimits( limits );
     return 0;
 }
 
 
+int trevi_decoder_set_hold_timeout(trevi_decoder *decoder, int holdTimeoutMs)
+{
+    if( holdTimeoutMs < 0 )
+        return -1;
+
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    dec->setHoldTimeout( (uint64_t)holdTimeoutMs * 1000000 );
+    return 0;
+}
+
+int trevi_decoder_poll(trevi_decoder *decoder)
+{
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    return dec->poll( stats_now_ns() );
+}
+
+int trevi_decoder_run(trevi_decoder *decoder, int budget)
+{
+    if( budget < 0 )
+        return -1;
+
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    dec->run( budget );
+    return dec->backlog();
+}
+
 int trevi_decoder_get_decoded_data(trevi_decoder *decoder, void *out_buffer, unsigned int * packetSeqIdx)
 {
     Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
@@ -124,3 +349,214 @@ int trevi_decoder_get_decoded_data(trevi_decoder *decoder, void *out_buffer, uns
 
     return -1;
 }
+
+
+int trevi_decoder_get_drop_counters(trevi_decoder *decoder, trevi_decoder_drop_counters *counters)
+{
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    counters->bad_checksum = dec->droppedBadChecksumCount();
+    counters->malformed = dec->droppedMalformedCount();
+    counters->redundant = dec->droppedRedundantCount();
+    return 0;
+}
+
+
+int trevi_decoder_get_decoded_view(trevi_decoder *decoder, trevi_decoded_view *view)
+{
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    if( dec->available() )
+    {
+        std::shared_ptr< SourceBlock > sb = dec->pop();
+        view->data = sb->payload_ptr();
+        view->size = sb->payload_size();
+        view->seq_idx = sb->get_global_sequence_idx();
+        view->ref = (void*)(new std::shared_ptr< SourceBlock >( sb ));
+        return view->size;
+    }
+
+    return -1;
+}
+
+
+void trevi_decoder_release_view(trevi_decoder *decoder, trevi_decoded_view *view)
+{
+    if( view->ref != nullptr )
+    {
+        delete reinterpret_cast< std::shared_ptr< SourceBlock >* >( view->ref );
+    }
+    view->data = nullptr;
+    view->size = 0;
+    view->ref = nullptr;
+}
+
+int trevi_decoder_start_recording(trevi_decoder *decoder, const char *path)
+{
+    if( path == nullptr )
+        return -1;
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    return dec->startRecording( path ) ? 0 : -1;
+}
+
+int trevi_decoder_stop_recording(trevi_decoder *decoder)
+{
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    dec->stopRecording();
+    return 0;
+}
+
+static void fillLatencyStats( const LatencyHistogram& histogram, trevi_latency_stats* stats )
+{
+    LatencySummary summary = histogram.summary();
+    stats->count = summary.count;
+    stats->min_ns = summary.minNs;
+    stats->max_ns = summary.maxNs;
+    stats->mean_ns = summary.meanNs;
+    stats->p50_ns = summary.p50Ns;
+    stats->p90_ns = summary.p90Ns;
+    stats->p99_ns = summary.p99Ns;
+    stats->p999_ns = summary.p999Ns;
+}
+
+static void fillStreamStats( int streamId, const StreamStats& streamStats, trevi_stream_stats* stats )
+{
+    stats->stream_id = streamId;
+    stats->packets_in = streamStats.packetsIn.value();
+    stats->packets_out = streamStats.packetsOut.value();
+    stats->recovered = streamStats.recovered.value();
+    stats->unrecoverable = streamStats.unrecoverable.value();
+    stats->resyncs = streamStats.resyncs.value();
+    stats->solver_rank = (int)streamStats.solverRank.value();
+    stats->window_occupancy = (int)streamStats.windowOccupancy.value();
+    stats->backlog = (int)streamStats.backlog.value();
+    stats->expired = streamStats.expired.value();
+    stats->dropped = streamStats.dropped.value();
+    stats->memory_bytes = streamStats.memoryBytes.value();
+}
+
+int trevi_encoder_get_stats(trevi_encoder *encoder, trevi_encoder_stats *stats)
+{
+    if( stats == nullptr )
+        return -1;
+
+    Encoder * enc = reinterpret_cast<Encoder*>(encoder->encoderRef);
+    memset( stats, 0, sizeof(trevi_encoder_stats) );
+    for( int i = 0; i < 32; ++i )
+    {
+        if( encoder->streamEncoderRefs[i] != nullptr )
+        {
+            StreamEncoder * streamEnc = reinterpret_cast<StreamEncoder*>(encoder->streamEncoderRefs[i]);
+            fillStreamStats( i, streamEnc->stats(), &stats->streams[ stats->num_streams ] );
+            stats->memory_bytes += stats->streams[ stats->num_streams++ ].memory_bytes;
+        }
+    }
+    fillLatencyStats( enc->encodeLatency(), &stats->encode_latency );
+    return 0;
+}
+
+int trevi_decoder_get_stats(trevi_decoder *decoder, trevi_decoder_stats *stats)
+{
+    if( stats == nullptr )
+        return -1;
+
+    Decoder * dec = reinterpret_cast<Decoder*>(decoder->decoderRef);
+    memset( stats, 0, sizeof(trevi_decoder_stats) );
+    for( int i = 0; i < 32; ++i )
+    {
+        if( decoder->streamDecoderRefs[i] != nullptr )
+        {
+            StreamDecoder * streamDec = reinterpret_cast<StreamDecoder*>(decoder->streamDecoderRefs[i]);
+            fillStreamStats( i, streamDec->stats(), &stats->streams[ stats->num_streams ] );
+            stats->memory_bytes += stats->streams[ stats->num_streams++ ].memory_bytes;
+        }
+    }
+    stats->memory_bytes += dec->outputBytes().value();
+    stats->dropped_outputs = dec->droppedOutputCount();
+    stats->drops.bad_checksum = dec->droppedBadChecksumCount();
+    stats->drops.malformed = dec->droppedMalformedCount();
+    stats->drops.redundant = dec->droppedRedundantCount();
+    fillLatencyStats( dec->decodeLatency(), &stats->decode_latency );
+    fillLatencyStats( dec->reorderingDelay(), &stats->reordering_delay );
+    return 0;
+}
+
+trevi_session_decoder *trevi_create_session_decoder(int decodingWindowSize, int idleTimeoutMs)
+{
+    if( decodingWindowSize <= 0 || decodingWindowSize > 65535 || idleTimeoutMs <= 0 )
+        return nullptr;
+
+    trevi_session_decoder * ret = new trevi_session_decoder;
+    ret->sessionTableRef = (void*)(new SessionTable( decodingWindowSize, (uint64_t)idleTimeoutMs * 1000000 ));
+    return ret;
+}
+
+int trevi_session_decoder_set_option(trevi_session_decoder *decoder, trevi_stream_option option, int value)
+{
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    switch( option )
+    {
+    case TREVI_DECODER_LAZY_PAYLOADS:
+        table->setLazyPayloads( value != 0 );
+        break;
+    case TREVI_DECODER_INACTIVATION:
+        table->setInactivation( value != 0 );
+        break;
+    case TREVI_DECODER_WORK_BUDGET:
+        if( value < 0 )
+            return -1;
+        table->setWorkBudget( value );
+        break;
+    default:
+        return -1; // Not a session decoder option
+    }
+
+    return 0;
+}
+
+int trevi_session_decode(trevi_session_decoder *decoder, const void *address, int addressSize, unsigned int sessionId, const void *buffer, int bufferSize)
+{
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    return table->addCodeBlock( address, addressSize, sessionId, buffer, bufferSize, stats_now_ns() ) ? 0 : -1;
+}
+
+int trevi_session_decoder_get_decoded_data(trevi_session_decoder *decoder, void *out_buffer, unsigned int *packetSeqIdx, trevi_session_key *key)
+{
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    SessionOutput out;
+    if( !table->pop( out ) )
+    {
+        return -1;
+    }
+
+    if( key != nullptr )
+    {
+        memcpy( key->address, out.key.address, sizeof(key->address) );
+        key->address_size = out.key.addressSize;
+        key->session_id = out.key.sessionId;
+        key->stream_id = out.key.streamId;
+    }
+    (*packetSeqIdx) = out.block->get_global_sequence_idx();
+    memcpy( out_buffer, out.block->payload_ptr(), out.block->payload_size() );
+    return out.block->payload_size();
+}
+
+int trevi_session_decoder_evict_idle(trevi_session_decoder *decoder)
+{
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    return table->evictIdle( stats_now_ns() );
+}
+
+int trevi_session_decoder_get_session_count(trevi_session_decoder *decoder)
+{
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    return table->sessionCount();
+}
+
+int trevi_session_decoder_get_stats(trevi_session_decoder *decoder, trevi_stream_stats *stats)
+{
+    if( stats == nullptr )
+        return -1;
+
+    SessionTable * table = reinterpret_cast<SessionTable*>(decoder->sessionTableRef);
+    fillStreamStats( -1, table->stats(), stats );
+    return 0;
+}
@@ -30,44 +30,6 @@ bool isBigEndian()
     return !isLittleEndian();
 }
 
-
-void write16ToBuffer(void *ptr, uint16_t value)
-{
-    uint8_t * bufferPtr = (uint8_t*)ptr;
-    uint16_t nValue = htons( value );
-    uint8_t partA = (uint8_t)((nValue & 0xFF00) >> 8);
-    uint8_t partB = (uint8_t)(nValue & 0x00FF);
-    bufferPtr[0] = partA;
-    bufferPtr[1] = partB;
-}
-
-uint16_t read16FromBuffer(void *ptr)
-{
-    uint8_t* bufferPtr = (uint8_t*)ptr;
-    uint8_t partA = bufferPtr[0];
-    uint8_t partB = bufferPtr[1];
-    uint16_t wd = ((uint16_t)partA << 8) | partB;
-    return htons( wd );
-}
-
-
-void write32ToBuffer(void *ptr, uint32_t value)
-{
-    uint32_t nValue = htonl( value );
-    memcpy(ptr, (const char *) &(nValue), sizeof(uint32_t) );
-}
-
-
-uint32_t read32FromBuffer(void *ptr)
-{
-    uint8_t* bufferPtr = (uint8_t*)ptr;
-    uint32_t nValue = (((uint32_t) bufferPtr[0]) << 0 |
-    ((uint32_t) bufferPtr[1]) << 8 |
-    ((uint32_t) bufferPtr[2]) <<  16 |
-    ((uint32_t) bufferPtr[3]) <<  24);
-    return ntohl( nValue );
-}
-
 void print_bytes(std::ostream& out, const char *title, const unsigned char *data, size_t dataLen, bool format, int symbol_per_line )
 {
     out << title << std::endl;